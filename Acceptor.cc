@@ -96,10 +96,12 @@ void Acceptor::handleRead()
     }
     else
     {
-        LOG_ERROR("%s:%s%d accept err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE) // 代表当前线程已达到其可打开文件描述符的最大数量限制
+        // fd耗尽时监听套接字会一直可读 每次循环都会走到这里 限流避免日志把情况变得更糟
+        int savedErrno = errno;
+        LOG_ERROR_EVERY_MS(1000, "%s:%s%d accept err:%d\n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+        if (savedErrno == EMFILE) // 代表当前线程已达到其可打开文件描述符的最大数量限制
         {
-            LOG_ERROR("%s:%s%d sockfd reached limit\n", __FILE__, __FUNCTION__, __LINE__);
+            LOG_ERROR_EVERY_MS(1000, "%s:%s%d sockfd reached limit\n", __FILE__, __FUNCTION__, __LINE__);
         }
     }
 }
\ No newline at end of file
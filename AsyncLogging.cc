@@ -0,0 +1,149 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                           off_t rollSize,
+                           int flushInterval)
+    : flushInterval_(flushInterval)
+    , running_(false)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , mutex_()
+    , cond_()
+    , currentBuffer_(new Buffer)
+    , nextBuffer_(new Buffer)
+    , buffers_()
+{
+    buffers_.reserve(16);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    running_ = false;
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::append(const char *logline, int len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (currentBuffer_->avail() > len)
+    {
+        currentBuffer_->append(logline, len);
+    }
+    else
+    {
+        buffers_.push_back(std::move(currentBuffer_));
+
+        if (nextBuffer_)
+        {
+            currentBuffer_ = std::move(nextBuffer_);
+        }
+        else
+        {
+            currentBuffer_.reset(new Buffer); // 前端写得太快 两块缓冲区都用完了 很少发生
+        }
+        currentBuffer_->append(logline, len);
+        cond_.notify_one();
+    }
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_);
+    // 后端也预先准备两块缓冲区 交换时归还给前端 避免前端分配内存
+    BufferPtr newBuffer1(new Buffer);
+    BufferPtr newBuffer2(new Buffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+
+    while (running_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty())
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            // 不管有没有写满 当前缓冲区也一起交给后端
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if (!nextBuffer_)
+            {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        // 日志堆积太多(前端写入远快于磁盘) 丢掉多余的部分 只保留两块
+        if (buffersToWrite.size() > 25)
+        {
+            char buf[256];
+            snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
+                     Timestamp::now().toString().c_str(),
+                     buffersToWrite.size() - 2);
+            fputs(buf, stderr);
+            output.append(buf, strlen(buf));
+            buffersToWrite.erase(buffersToWrite.begin() + 2, buffersToWrite.end());
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        if (buffersToWrite.size() > 2)
+        {
+            buffersToWrite.resize(2);
+        }
+
+        // 把写完的缓冲区回收 作为下一轮的备用缓冲区
+        if (!newBuffer1)
+        {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2)
+        {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+
+        buffersToWrite.clear();
+        output.flush();
+    }
+    // 退出前把剩余的日志写完 currentBuffer_保留给stop之后的append使用
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        buffersToWrite.swap(buffers_);
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+        output.append(currentBuffer_->data(), currentBuffer_->length());
+        currentBuffer_->reset();
+    }
+    output.flush();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "noncopyable.h"
+#include "Thread.h"
+#include "FixedBuffer.h"
+
+/*
+ * 异步日志 双缓冲
+ * - 前端(任意线程)调用append 只在锁内把日志拷贝到预先分配的currentBuffer_中
+ * - currentBuffer_写满后放入buffers_ 换上nextBuffer_ 唤醒后端线程
+ * - 后端线程每flushInterval秒或者被唤醒时 把buffers_整体交换出来 在锁外写入LogFile
+ * 前端不做任何磁盘IO 事件循环不会被日志拖慢
+ *
+ * 使用方法：
+ *   AsyncLogging *g_asyncLog = ...;
+ *   void asyncOutput(const char *msg, int len) { g_asyncLog->append(msg, len); }
+ *   Logger::instance().setOutput(asyncOutput);
+ *   g_asyncLog->start();
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename,
+                 off_t rollSize,
+                 int flushInterval = 3);
+    ~AsyncLogging();
+
+    // 前端接口 线程安全
+    void append(const char *logline, int len);
+
+    void start();
+    void stop();
+
+private:
+    // 后端线程函数
+    void threadFunc();
+
+    using Buffer = FixedBuffer<kLargeBuffer>;
+    using BufferPtr = std::unique_ptr<Buffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    const int flushInterval_;
+    std::atomic_bool running_;
+    const std::string basename_;
+    const off_t rollSize_;
+    Thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+
+    BufferPtr currentBuffer_; // 当前正在写的缓冲区
+    BufferPtr nextBuffer_;    // 预备缓冲区
+    BufferVector buffers_;    // 已写满 等待后端写入文件的缓冲区
+};
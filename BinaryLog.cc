@@ -0,0 +1,541 @@
+#include "BinaryLog.h"
+#include "LogRing.h"
+#include "Logger.h"
+#include "Thread.h"
+#include "Timestamp.h"
+#include "CurrentThread.h"
+
+#include <chrono>
+#include <deque>
+#include <errno.h>
+
+const char BinaryLog::kFileMagic[8] = {'M', 'U', 'D', 'U', 'O', 'B', 'L', '1'};
+
+std::atomic_bool BinaryLog::s_enabled_(false);
+
+namespace
+{
+    // 每个线程持有自己的二进制日志环 与RingLogging的文本环相互独立 不共用
+    thread_local LogRingHolder t_binaryRingHolder;
+
+    const size_t kDefaultRingSize = 1024 * 1024;
+
+    // 二进制文件中的记录类型
+    const char kFormatRecord = 'F';
+    const char kLogRecord = 'L';
+
+    // 解码时对文件内容的合理性检查 超出时认为文件已损坏 避免按照错误的长度申请巨大的内存
+    const uint32_t kMaxFormatStringLen = 64 * 1024; // 源文件名和格式串的最大长度
+
+    // 解码时读取的一个参数
+    struct DecodedArg
+    {
+        char tag;
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *str;
+        uint32_t strLen;
+    };
+
+    bool readArg(const char *&cur, const char *end, DecodedArg *arg)
+    {
+        if (cur >= end)
+        {
+            return false;
+        }
+        arg->tag = *cur++;
+        switch (arg->tag)
+        {
+        case binlog::kInt:
+        case binlog::kUint:
+        case binlog::kDouble:
+        case binlog::kPointer:
+            if (end - cur < 8)
+            {
+                return false;
+            }
+            ::memcpy(&arg->u, cur, 8); // 三种类型都是8字节 按需解释
+            ::memcpy(&arg->i, cur, 8);
+            ::memcpy(&arg->d, cur, 8);
+            cur += 8;
+            return true;
+        case binlog::kString:
+            if (end - cur < 4)
+            {
+                return false;
+            }
+            ::memcpy(&arg->strLen, cur, 4);
+            cur += 4;
+            if (static_cast<size_t>(end - cur) < arg->strLen)
+            {
+                return false;
+            }
+            arg->str = cur;
+            cur += arg->strLen;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    int64_t argAsInt(const DecodedArg &arg)
+    {
+        return arg.tag == binlog::kDouble ? static_cast<int64_t>(arg.d) : arg.i;
+    }
+
+    // snprintf追加之后的新长度 保证不越界
+    size_t appendFormatted(size_t n, size_t size, int written)
+    {
+        if (written < 0)
+        {
+            return n;
+        }
+        return n + written < size ? n + written : size - 1;
+    }
+}
+
+namespace binlog
+{
+    int formatMessage(const char *fmt, const char *args, size_t argsLen, char *out, size_t outSize)
+    {
+        const char *cur = args;
+        const char *end = args + argsLen;
+        size_t n = 0;
+        const char *p = fmt;
+
+        while (*p != '\0' && n + 1 < outSize)
+        {
+            if (*p != '%')
+            {
+                out[n++] = *p++;
+                continue;
+            }
+            if (p[1] == '%')
+            {
+                out[n++] = '%';
+                p += 2;
+                continue;
+            }
+
+            // 解析一个转换说明 %[flags][width][.precision][length]conversion
+            // 长度修饰符统一替换为参数编码时的类型
+            std::string spec("%");
+            ++p;
+            while (*p != '\0' && ::strchr("-+ #0", *p) != nullptr)
+            {
+                spec += *p++;
+            }
+            DecodedArg arg;
+            if (*p == '*') // 宽度由参数给出
+            {
+                ++p;
+                if (readArg(cur, end, &arg))
+                {
+                    spec += std::to_string(argAsInt(arg));
+                }
+            }
+            while (*p >= '0' && *p <= '9')
+            {
+                spec += *p++;
+            }
+            if (*p == '.')
+            {
+                spec += *p++;
+                if (*p == '*')
+                {
+                    ++p;
+                    if (readArg(cur, end, &arg))
+                    {
+                        spec += std::to_string(argAsInt(arg));
+                    }
+                }
+                while (*p >= '0' && *p <= '9')
+                {
+                    spec += *p++;
+                }
+            }
+            while (*p != '\0' && ::strchr("hlLqjzt", *p) != nullptr)
+            {
+                ++p;
+            }
+            char conv = *p;
+            if (conv == '\0')
+            {
+                break;
+            }
+            ++p;
+
+            if (!readArg(cur, end, &arg))
+            {
+                n = appendFormatted(n, outSize, snprintf(out + n, outSize - n, "<?>"));
+                continue;
+            }
+
+            int written = -1;
+            switch (conv)
+            {
+            case 'd':
+            case 'i':
+                spec += "lld";
+                written = snprintf(out + n, outSize - n, spec.c_str(), static_cast<long long>(argAsInt(arg)));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec += "ll";
+                spec += conv;
+                written = snprintf(out + n, outSize - n, spec.c_str(),
+                                   static_cast<unsigned long long>(arg.tag == binlog::kDouble ? static_cast<uint64_t>(arg.d) : arg.u));
+                break;
+            case 'c':
+                spec += 'c';
+                written = snprintf(out + n, outSize - n, spec.c_str(), static_cast<int>(argAsInt(arg)));
+                break;
+            case 'e': case 'E': case 'f': case 'F':
+            case 'g': case 'G': case 'a': case 'A':
+                spec += conv;
+                written = snprintf(out + n, outSize - n, spec.c_str(),
+                                   arg.tag == binlog::kDouble ? arg.d : static_cast<double>(arg.i));
+                break;
+            case 's':
+                if (arg.tag == binlog::kString)
+                {
+                    std::string str(arg.str, arg.strLen);
+                    spec += 's';
+                    written = snprintf(out + n, outSize - n, spec.c_str(), str.c_str());
+                }
+                else
+                {
+                    written = snprintf(out + n, outSize - n, "<?>");
+                }
+                break;
+            case 'p':
+                spec += 'p';
+                written = snprintf(out + n, outSize - n, spec.c_str(), reinterpret_cast<void*>(static_cast<uintptr_t>(arg.u)));
+                break;
+            default: // 不认识的转换说明 原样跳过
+                break;
+            }
+            n = appendFormatted(n, outSize, written);
+        }
+        out[n] = '\0';
+        return static_cast<int>(n);
+    }
+}
+
+BinaryLog& BinaryLog::instance()
+{
+    // 故意不析构 其它线程在进程退出时可能还在写日志
+    static BinaryLog *binaryLog = new BinaryLog;
+    return *binaryLog;
+}
+
+BinaryLog::BinaryLog()
+    : formatsWritten_(0)
+    , droppedOfClosedRings_(0)
+    , ringSize_(kDefaultRingSize)
+    , file_(nullptr)
+    , running_(false)
+{
+}
+
+BinaryLog::~BinaryLog()
+{
+}
+
+int BinaryLog::registerFormat(int level, const char *file, int line, const char *fmt)
+{
+    std::unique_lock<std::mutex> lock(formatsMutex_);
+    FormatInfo info;
+    info.level = level;
+    info.line = line;
+    info.file = file;
+    info.fmt = fmt;
+    formats_.push_back(info);
+    return static_cast<int>(formats_.size() - 1);
+}
+
+LogRing* BinaryLog::threadRing()
+{
+    if (__builtin_expect(t_binaryRingHolder.ring == nullptr, 0))
+    {
+        t_binaryRingHolder.ring = new LogRing(ringSize_);
+        std::unique_lock<std::mutex> lock(ringsMutex_);
+        rings_.push_back(t_binaryRingHolder.ring);
+    }
+    return t_binaryRingHolder.ring;
+}
+
+void BinaryLog::append(int formatId, char *record, size_t len)
+{
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    uint32_t id = static_cast<uint32_t>(formatId);
+    int32_t tid = CurrentThread::tid();
+    ::memcpy(record, &now, sizeof now);
+    ::memcpy(record + sizeof now, &id, sizeof id);
+    ::memcpy(record + sizeof now + sizeof id, &tid, sizeof tid);
+
+    LogRing *ring = threadRing();
+    if (!ring->push(record, static_cast<uint32_t>(len)))
+    {
+        ring->addDropped(); // 后端跟不上 丢弃并计数 不阻塞IO线程
+    }
+}
+
+void BinaryLog::start(const std::string &path)
+{
+    if (running_)
+    {
+        return;
+    }
+    if (!path.empty())
+    {
+        file_ = ::fopen(path.c_str(), "we");
+        if (file_ == nullptr)
+        {
+            LOG_ERROR("BinaryLog::start open %s failed errno:%d\n", path.c_str(), errno);
+            return;
+        }
+        ::fwrite(kFileMagic, 1, sizeof kFileMagic, file_);
+        formatsWritten_ = 0;
+    }
+    running_ = true;
+    thread_.reset(new Thread(std::bind(&BinaryLog::threadFunc, this), "BinaryLog"));
+    thread_->start();
+    s_enabled_ = true;
+}
+
+void BinaryLog::stop()
+{
+    if (!running_)
+    {
+        return;
+    }
+    s_enabled_ = false;
+    running_ = false;
+    cond_.notify_one();
+    thread_->join();
+    thread_.reset();
+    if (file_)
+    {
+        ::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+uint64_t BinaryLog::droppedCount()
+{
+    uint64_t dropped = droppedOfClosedRings_;
+    std::unique_lock<std::mutex> lock(ringsMutex_);
+    for (LogRing *ring : rings_)
+    {
+        dropped += ring->dropped();
+    }
+    return dropped;
+}
+
+void BinaryLog::threadFunc()
+{
+    while (running_)
+    {
+        if (!drain())
+        {
+            // 前端不通知后端(热路径上不做任何系统调用) 没有记录时定期轮询
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+    drain(); // 退出前取完剩余的记录
+    if (file_)
+    {
+        ::fflush(file_);
+    }
+}
+
+bool BinaryLog::drain()
+{
+    std::vector<LogRing*> rings;
+    {
+        std::unique_lock<std::mutex> lock(ringsMutex_);
+        rings = rings_;
+    }
+
+    bool handled = false;
+    std::vector<char> record;
+    for (LogRing *ring : rings)
+    {
+        while (ring->front(&record))
+        {
+            handleRecord(record);
+            ring->pop();
+            handled = true;
+        }
+    }
+
+    // 释放线程已经退出并且已经取空的环形缓冲区
+    {
+        std::unique_lock<std::mutex> lock(ringsMutex_);
+        for (std::vector<LogRing*>::iterator it = rings_.begin(); it != rings_.end(); )
+        {
+            if ((*it)->closed() && (*it)->empty())
+            {
+                droppedOfClosedRings_ += (*it)->dropped();
+                delete *it;
+                it = rings_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    return handled;
+}
+
+void BinaryLog::writeNewFormats()
+{
+    std::unique_lock<std::mutex> lock(formatsMutex_);
+    for (; formatsWritten_ < formats_.size(); ++formatsWritten_)
+    {
+        const FormatInfo &info = formats_[formatsWritten_];
+        uint32_t id = static_cast<uint32_t>(formatsWritten_);
+        int32_t level = info.level;
+        int32_t line = info.line;
+        uint32_t fileLen = static_cast<uint32_t>(info.file.size());
+        uint32_t fmtLen = static_cast<uint32_t>(info.fmt.size());
+        ::fwrite(&kFormatRecord, 1, 1, file_);
+        ::fwrite(&id, sizeof id, 1, file_);
+        ::fwrite(&level, sizeof level, 1, file_);
+        ::fwrite(&line, sizeof line, 1, file_);
+        ::fwrite(&fileLen, sizeof fileLen, 1, file_);
+        ::fwrite(info.file.data(), 1, fileLen, file_);
+        ::fwrite(&fmtLen, sizeof fmtLen, 1, file_);
+        ::fwrite(info.fmt.data(), 1, fmtLen, file_);
+    }
+}
+
+void BinaryLog::handleRecord(const std::vector<char> &record)
+{
+    if (record.size() < kHeaderSize)
+    {
+        return;
+    }
+    int64_t time = 0;
+    uint32_t id = 0;
+    ::memcpy(&time, &record[0], sizeof time);
+    ::memcpy(&id, &record[sizeof time], sizeof id);
+
+    if (file_)
+    {
+        // 记录用到的格式串必须先写入文件 解码时才能找到
+        if (id >= formatsWritten_)
+        {
+            writeNewFormats();
+        }
+        uint32_t len = static_cast<uint32_t>(record.size());
+        ::fwrite(&kLogRecord, 1, 1, file_);
+        ::fwrite(&len, sizeof len, 1, file_);
+        ::fwrite(&record[0], 1, len, file_);
+        return;
+    }
+
+    // 后台解码为文本
+    FormatInfo info;
+    {
+        std::unique_lock<std::mutex> lock(formatsMutex_);
+        if (id >= formats_.size())
+        {
+            return;
+        }
+        info = formats_[id];
+    }
+    char msg[kMaxRecordSize * 2];
+    int len = binlog::formatMessage(info.fmt.c_str(), &record[kHeaderSize], record.size() - kHeaderSize,
+                                    msg, sizeof msg);
+    Logger::instance().log(info.level, Timestamp(time), msg, len);
+}
+
+bool BinaryLog::decodeFile(FILE *in, FILE *out)
+{
+    char magic[sizeof kFileMagic];
+    if (::fread(magic, 1, sizeof magic, in) != sizeof magic
+        || ::memcmp(magic, kFileMagic, sizeof magic) != 0)
+    {
+        return false;
+    }
+
+    std::deque<FormatInfo> formats;
+    std::vector<char> record;
+    char type;
+    while (::fread(&type, 1, 1, in) == 1)
+    {
+        if (type == kFormatRecord)
+        {
+            uint32_t id, fileLen, fmtLen;
+            int32_t level, line;
+            // 格式串按id从0开始依次写入 id必须正好是下一个
+            if (::fread(&id, sizeof id, 1, in) != 1
+                || id != formats.size()
+                || ::fread(&level, sizeof level, 1, in) != 1
+                || ::fread(&line, sizeof line, 1, in) != 1
+                || ::fread(&fileLen, sizeof fileLen, 1, in) != 1
+                || fileLen > kMaxFormatStringLen)
+            {
+                return false;
+            }
+            FormatInfo info;
+            info.level = level;
+            info.line = line;
+            info.file.resize(fileLen);
+            if (fileLen > 0 && ::fread(&info.file[0], 1, fileLen, in) != fileLen)
+            {
+                return false;
+            }
+            if (::fread(&fmtLen, sizeof fmtLen, 1, in) != 1 || fmtLen > kMaxFormatStringLen)
+            {
+                return false;
+            }
+            info.fmt.resize(fmtLen);
+            if (fmtLen > 0 && ::fread(&info.fmt[0], 1, fmtLen, in) != fmtLen)
+            {
+                return false;
+            }
+            formats.push_back(info);
+        }
+        else if (type == kLogRecord)
+        {
+            uint32_t len;
+            // 写入时每条记录不超过kMaxRecordSize
+            if (::fread(&len, sizeof len, 1, in) != 1 || len < kHeaderSize || len > kMaxRecordSize)
+            {
+                return false;
+            }
+            record.resize(len);
+            if (::fread(&record[0], 1, len, in) != len)
+            {
+                return false;
+            }
+            int64_t time = 0;
+            uint32_t id = 0;
+            ::memcpy(&time, &record[0], sizeof time);
+            ::memcpy(&id, &record[sizeof time], sizeof id);
+            if (id >= formats.size())
+            {
+                return false;
+            }
+            char msg[kMaxRecordSize * 2];
+            int msgLen = binlog::formatMessage(formats[id].fmt.c_str(), &record[kHeaderSize], len - kHeaderSize,
+                                               msg, sizeof msg);
+            char line[kMaxRecordSize * 2 + 128];
+            int lineLen = Logger::formatLine(line, sizeof line, formats[id].level, Timestamp(time), msg, msgLen);
+            ::fwrite(line, 1, lineLen, out);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
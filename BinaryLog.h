@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <string>
+#include <memory>
+#include <type_traits>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "noncopyable.h"
+
+class LogRing;
+class Thread;
+
+/*
+ * 二进制日志模式(延迟格式化)
+ * - 每个LOG_XXX调用点第一次执行时把格式串注册到BinaryLog 得到一个格式id
+ * - 热路径上只把 时间戳+格式id+线程id+原始参数 拷贝到当前线程的LogRing中 不调用snprintf
+ * - 后端线程定期取出所有线程的记录
+ *   start(path)：原样写入二进制文件 由example/logdecoder离线还原为文本
+ *   start()：在后端线程中格式化为文本 交给Logger的输出函数
+ * 调用点不需要修改 Logger.h中的LOG_XXX宏在enabled()时自动走这条路径
+ */
+namespace binlog
+{
+    // 参数的类型标记 写在每个参数前面
+    enum ArgType
+    {
+        kInt = 'i',     // 有符号整数 统一存为int64_t
+        kUint = 'u',    // 无符号整数 统一存为uint64_t
+        kDouble = 'd',  // 浮点数
+        kString = 's',  // 字符串 存长度+内容
+        kPointer = 'p', // 指针 存地址
+    };
+
+    // 把参数编码到固定大小的缓冲区中 空间不足时截断字符串或丢弃剩余参数
+    struct Encoder
+    {
+        Encoder(char *begin, char *end)
+            : cur(begin)
+            , end(end)
+        {
+        }
+
+        void put(const void *data, size_t len)
+        {
+            if (static_cast<size_t>(end - cur) >= len)
+            {
+                ::memcpy(cur, data, len);
+                cur += len;
+            }
+        }
+
+        template <typename T>
+        void putTagged(char tag, T value)
+        {
+            if (static_cast<size_t>(end - cur) >= 1 + sizeof value)
+            {
+                *cur++ = tag;
+                put(&value, sizeof value);
+            }
+        }
+
+        char *cur;
+        char *end;
+    };
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    encodeArg(Encoder &enc, T value)
+    {
+        enc.putTagged(kInt, static_cast<int64_t>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    encodeArg(Encoder &enc, T value)
+    {
+        enc.putTagged(kUint, static_cast<uint64_t>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    encodeArg(Encoder &enc, T value)
+    {
+        enc.putTagged(kInt, static_cast<int64_t>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    encodeArg(Encoder &enc, T value)
+    {
+        enc.putTagged(kDouble, static_cast<double>(value));
+    }
+
+    template <typename T>
+    void encodeArg(Encoder &enc, const T *ptr)
+    {
+        enc.putTagged(kPointer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr)));
+    }
+
+    // 字符串需要拷贝内容 格式化时原来的内存可能已经释放
+    inline void encodeArg(Encoder &enc, const char *str)
+    {
+        if (str == nullptr)
+        {
+            str = "(null)";
+        }
+        size_t avail = static_cast<size_t>(enc.end - enc.cur);
+        if (avail < 1 + sizeof(uint32_t))
+        {
+            return;
+        }
+        uint32_t len = static_cast<uint32_t>(::strlen(str));
+        if (len > avail - 1 - sizeof len)
+        {
+            len = static_cast<uint32_t>(avail - 1 - sizeof len);
+        }
+        *enc.cur++ = kString;
+        enc.put(&len, sizeof len);
+        enc.put(str, len);
+    }
+
+    inline void encodeArgs(Encoder &)
+    {
+    }
+
+    template <typename T, typename... Args>
+    void encodeArgs(Encoder &enc, T value, Args... args)
+    {
+        encodeArg(enc, value);
+        encodeArgs(enc, args...);
+    }
+
+    // 按照格式串和编码后的参数还原出文本 返回写入out的长度
+    int formatMessage(const char *fmt, const char *args, size_t argsLen, char *out, size_t outSize);
+}
+
+class BinaryLog : noncopyable
+{
+public:
+    // 记录头：int64 时间戳(微秒) + uint32 格式id + int32 线程id
+    static const size_t kHeaderSize = sizeof(int64_t) + sizeof(uint32_t) + sizeof(int32_t);
+    // 单条记录的最大长度 与文本日志的缓冲区一致
+    static const size_t kMaxRecordSize = 1024;
+
+    static BinaryLog& instance();
+
+    // 是否开启了二进制日志模式 LOG_XXX宏据此选择路径
+    static bool enabled() { return s_enabled_.load(std::memory_order_relaxed); }
+
+    // 注册一个调用点的格式串 返回格式id 每个调用点只注册一次
+    int registerFormat(int level, const char *file, int line, const char *fmt);
+
+    // 热路径：把原始参数编码后放入当前线程的环形缓冲区
+    template <typename... Args>
+    void write(int formatId, Args... args)
+    {
+        char record[kMaxRecordSize];
+        binlog::Encoder enc(record + kHeaderSize, record + sizeof record);
+        binlog::encodeArgs(enc, args...);
+        append(formatId, record, static_cast<size_t>(enc.cur - record));
+    }
+
+    // 设置每个线程环形缓冲区的大小 需要在start之前调用
+    void setRingSize(size_t bytes) { ringSize_ = bytes; }
+
+    // 开启二进制日志 path为空时在后端线程中格式化为文本交给Logger输出
+    void start(const std::string &path = std::string());
+    // 停止后端线程 取完所有剩余的记录
+    void stop();
+
+    // 因为环形缓冲区满而丢弃的记录总数
+    uint64_t droppedCount();
+
+    // 离线解码：读取二进制日志文件 输出文本日志 格式错误返回false
+    static bool decodeFile(FILE *in, FILE *out);
+
+    static const char kFileMagic[8];
+
+private:
+    struct FormatInfo
+    {
+        int level;
+        int line;
+        std::string file;
+        std::string fmt;
+    };
+
+    BinaryLog();
+    ~BinaryLog();
+
+    // 填写记录头并放入当前线程的环形缓冲区
+    void append(int formatId, char *record, size_t len);
+    // 获取当前线程的环形缓冲区 第一次调用时创建并注册
+    LogRing* threadRing();
+
+    void threadFunc();
+    // 取出所有线程的记录并处理 返回是否处理了记录
+    bool drain();
+    // 二进制文件模式下写出新注册的格式串
+    void writeNewFormats();
+    void handleRecord(const std::vector<char> &record);
+
+    static std::atomic_bool s_enabled_;
+
+    std::mutex formatsMutex_;
+    std::vector<FormatInfo> formats_;
+    size_t formatsWritten_; // 已经写入文件的格式串个数 只由后端线程访问
+
+    std::mutex ringsMutex_;
+    std::vector<LogRing*> rings_;
+    std::atomic<uint64_t> droppedOfClosedRings_; // 已经释放的环形缓冲区的丢弃计数
+    size_t ringSize_;
+
+    FILE *file_; // 为空表示在后台解码为文本
+    std::atomic_bool running_;
+    std::unique_ptr<Thread> thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
@@ -3,56 +3,280 @@
 #include <unistd.h>
 
 #include "Buffer.h"
+#include "BufferPool.h"
+
+const size_t Buffer::kMinReadHint;
+const size_t Buffer::kMaxReadHint;
+char Buffer::kEmptyData[1] = { '\0' };
+
+Buffer::Buffer(size_t initalSize)
+    : pool_(nullptr)
+    , data_(nullptr)
+    , capacity_(0)
+    , initialSize_(initalSize)
+    , readerIndex_(kCheapPrepend)
+    , writerIndex_(kCheapPrepend)
+    , readHint_(std::max(kMinReadHint, std::min(initalSize, kMaxReadHint)))
+{
+}
+
+Buffer::Buffer(const std::shared_ptr<BufferPool> &pool, size_t initalSize)
+    : pool_(pool)
+    , data_(nullptr)
+    , capacity_(0)
+    , initialSize_(initalSize)
+    , readerIndex_(kCheapPrepend)
+    , writerIndex_(kCheapPrepend)
+    , readHint_(std::max(kMinReadHint, std::min(initalSize, kMaxReadHint)))
+{
+}
+
+Buffer::~Buffer()
+{
+    BufferPool::deallocate(pool_.get(), data_, capacity_);
+}
+
+// 拷贝出来的Buffer不属于任何pool 可能在别的线程中使用
+Buffer::Buffer(const Buffer &other)
+    : pool_(nullptr)
+    , data_(nullptr)
+    , capacity_(0)
+    , initialSize_(other.initialSize_)
+    , readerIndex_(other.readerIndex_)
+    , writerIndex_(other.writerIndex_)
+    , readHint_(other.readHint_)
+{
+    if (other.data_)
+    {
+        data_ = BufferPool::allocate(nullptr, other.capacity_, &capacity_);
+        ::memcpy(data_, other.data_, other.writerIndex_);
+    }
+}
+
+Buffer& Buffer::operator=(const Buffer &other)
+{
+    if (this != &other)
+    {
+        Buffer tmp(other);
+        swap(tmp);
+    }
+    return *this;
+}
+
+Buffer::Buffer(Buffer &&other)
+    : pool_(other.pool_)
+    , data_(other.data_)
+    , capacity_(other.capacity_)
+    , initialSize_(other.initialSize_)
+    , readerIndex_(other.readerIndex_)
+    , writerIndex_(other.writerIndex_)
+    , readHint_(other.readHint_)
+{
+    other.data_ = nullptr;
+    other.capacity_ = 0;
+    other.readerIndex_ = kCheapPrepend;
+    other.writerIndex_ = kCheapPrepend;
+}
+
+Buffer& Buffer::operator=(Buffer &&other)
+{
+    if (this != &other)
+    {
+        Buffer tmp(std::move(other));
+        swap(tmp);
+    }
+    return *this;
+}
+
+void Buffer::swap(Buffer &other)
+{
+    std::swap(pool_, other.pool_);
+    std::swap(data_, other.data_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(initialSize_, other.initialSize_);
+    std::swap(readerIndex_, other.readerIndex_);
+    std::swap(writerIndex_, other.writerIndex_);
+    std::swap(readHint_, other.readHint_);
+}
+
+void Buffer::release()
+{
+    BufferPool::deallocate(pool_.get(), data_, capacity_);
+    data_ = nullptr;
+    capacity_ = 0;
+}
+
+void Buffer::shrink(size_t reserve)
+{
+    size_t readable = readableBytes();
+    if (readable == 0 && reserve == 0)
+    {
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = kCheapPrepend;
+        release();
+        return;
+    }
+    size_t newCapacity = 0;
+    char *newData = BufferPool::allocate(pool_.get(), kCheapPrepend + readable + reserve, &newCapacity);
+    if (readable > 0)
+    {
+        ::memcpy(newData + kCheapPrepend, peek(), readable);
+    }
+    BufferPool::deallocate(pool_.get(), data_, capacity_);
+    data_ = newData;
+    capacity_ = newCapacity;
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = readerIndex_ + readable;
+}
+
+void Buffer::makePrependSpace(size_t len)
+{
+    size_t prependable = prependableBytes();
+    if (data_ != nullptr && prependable >= len)
+    {
+        return;
+    }
+    size_t readable = readableBytes();
+    ensureWritableBytes(len); // 可能重新分配 之后readerIndex_回到kCheapPrepend
+    if (data_ != nullptr && prependableBytes() < len)
+    {
+        // 可读数据整体后移 空出len字节
+        size_t shift = len - prependableBytes();
+        ::memmove(begin() + readerIndex_ + shift, peek(), readable);
+        readerIndex_ += shift;
+        writerIndex_ += shift;
+    }
+}
+
+void Buffer::makeSpace(size_t len)
+{
+    /**
+     * | kCheapPrepend |xxx| reader | writer |                     // xxx标示reader中已读的部分
+     * | kCheapPrepend | reader ｜          len          |
+     **/
+    size_t readable = readableBytes(); // readable = reader的长度
+    if (data_ == nullptr || writableBytes() + prependableBytes() < len + kCheapPrepend)
+    {
+        // 按倍数扩容 持续追加时只需要O(log n)次重新分配和拷贝
+        // 还没有申请过内存时按照initialSize_申请
+        size_t want = std::max(kCheapPrepend + readable + len,
+                               std::max(capacity_ * 2, kCheapPrepend + initialSize_));
+        size_t newCapacity = 0;
+        char *newData = BufferPool::allocate(pool_.get(), want, &newCapacity);
+        // 只需要搬运可读的数据 已读的部分直接丢弃
+        if (readable > 0)
+        {
+            ::memcpy(newData + kCheapPrepend, peek(), readable);
+        }
+        BufferPool::deallocate(pool_.get(), data_, capacity_);
+        data_ = newData;
+        capacity_ = newCapacity;
+    }
+    else    // 这里说明 len <= xxx + writer 把reader搬到从xxx开始 使得xxx后面是一段连续空间
+    {
+        // 将当前缓冲区中从readerIndex_到writerIndex_的数据
+        // 拷贝到缓冲区起始位置kCheapPrepend处，以便腾出更多的可写空间
+        ::memmove(begin() + kCheapPrepend, peek(), readable);
+    }
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = readerIndex_ + readable;
+}
 
 /**
  * 从fd上读取数据 Poller工作在LT模式
  * Buffer缓冲区是有大小的！ 但是从fd上读取数据的时候 却不知道tcp数据的最终大小
  *
  * @description: 从socket读到缓冲区的方法是使用readv先读至buffer_，
- * Buffer_空间如果不够会读入到栈上65536个字节大小的空间，然后以append的
+ * Buffer_空间如果不够会读入到scratch(每个loop共用的64KB)，然后以append的
  * 方式追加入buffer_。既考虑了避免系统调用带来开销，又不影响数据的接收。
+ *
+ * 自适应读取大小：readHint_记录这个连接一次通常能读到多少数据
+ * - 读之前保证至少有readHint_字节的可写空间 大部分数据直接读进Buffer 不需要再从scratch拷贝
+ * - scratch部分最多只提供readHint_的2倍(至少4KB) 一次读取的总量有上限 其它连接不会被饿着
+ *   LT模式下没有读完的数据下一轮还会通知
+ * - 读满了说明对端发得快 readHint_翻倍 没读满就向实际读到的量靠拢
+ * 小消息的RPC连接只占用1KB级别的缓冲区 大流量的连接很快增长到kMaxReadHint
  **/
-
-ssize_t Buffer::readFd(int fd, int *saveErrno)
+ssize_t Buffer::readFd(int fd, int *saveErrno, char *scratch, size_t scratchSize)
 {
-    char extrabuf[65536] = {0}; // 栈上的内存空间
-    /*
-    struct iovec {
-        ptr_t iov_base; // iov_base指向的缓冲区存放的是readv所接收的数据或是writev将要发送的数据
-        size_t iov_len; // iov_len在各种情况下分别确定了接收的最大长度以及实际写入的长度
-    };
-    */
+    char stackbuf[65536]; // 没有传入scratch时使用 不需要清零 readv会覆盖
+    if (scratch == nullptr)
+    {
+        scratch = stackbuf;
+        scratchSize = sizeof stackbuf;
+    }
+
+    // 还没有申请内存(第一次读或者读空释放之后)时只读到scratch 读到数据才申请
+    // 这样读到EOF或者EAGAIN的连接不会从pool中取块
+    if (data_ == nullptr)
+    {
+        const size_t offered = std::min(scratchSize, readHint_ + std::max(readHint_ * 2, static_cast<size_t>(4096)));
+        const ssize_t n = ::read(fd, scratch, offered);
+        if (n < 0)
+        {
+            *saveErrno = errno;
+            return n;
+        }
+        const size_t nread = static_cast<size_t>(n);
+        if (nread > 0)
+        {
+            ensureWritableBytes(std::max(nread, readHint_));
+            append(scratch, nread);
+        }
+        updateReadHint(nread, offered);
+        return n;
+    }
+
+    ensureWritableBytes(readHint_);
+    const size_t writable = writableBytes();    // 这是Buffer底层缓冲区剩余的可写空间大小 不一定能完全存储从fd读出的数据
+    const size_t extra = std::min(scratchSize, std::max(readHint_ * 2, static_cast<size_t>(4096)));
+
     // 使用iovec分配两个连续的缓冲区
     struct iovec vec[2];
-    const size_t writable = writableBytes();    // 这是Buffer底层缓冲区剩余的可写空间大小 不一定能完全存储从fd读出的数据
-   
     // 第一块缓冲区，指向可写空间
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
-    // 第二块缓冲区，指向栈空间
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    // 第二块缓冲区，指向scratch
+    vec[1].iov_base = scratch;
+    vec[1].iov_len = extra;
 
-    // 如果第一个缓冲区>=64k 那就只采用一个缓冲区 而不使用栈空间extrabuf[65536]的内容
-    // 如果第一个缓冲区<64k 则采用两个缓冲区
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    // 可写空间已经足够大时只用一个缓冲区
+    const int iovcnt = (writable < kMaxReadHint) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt); // n 表示从fd读取的数据大小
     if (n < 0)
     {
-       *saveErrno = errno; 
+        *saveErrno = errno;
+        return n;
     }
-    else if (n <= writable) // Buffer的可写缓冲区已经够存储读出来的数据了
+
+    const size_t nread = static_cast<size_t>(n);
+    if (nread <= writable) // Buffer的可写缓冲区已经够存储读出来的数据了
     {
-       writerIndex_ += n; 
+        writerIndex_ += nread;
     }
-    else // extrabuf里面也写入了n-writable长度的数据
+    else // scratch里面也写入了n-writable长度的数据
     {
-        writerIndex_ = buffer_.size(); 
-        append(extrabuf, n - writable); // 对buffer_扩容 并将extrabuf存储的另一部分数据追加至buffer_
+        writerIndex_ = capacity_;
+        append(scratch, nread - writable); // 对buffer_扩容 并将scratch存储的另一部分数据追加至buffer_
     }
+
+    updateReadHint(nread, writable + (iovcnt == 2 ? extra : 0));
     return n;
 }
 
+// 更新readHint_ 读满了说明还有更多数据 加倍 否则向这次的读取量靠拢
+void Buffer::updateReadHint(size_t nread, size_t offered)
+{
+    if (nread == offered)
+    {
+        readHint_ = std::min(readHint_ * 2, kMaxReadHint);
+    }
+    else if (nread > 0)
+    {
+        readHint_ = std::max(kMinReadHint, (readHint_ * 3 + nread) / 4);
+    }
+}
+
 ssize_t Buffer::writeFd(int fd, int *saveErrno)
 {
     ssize_t n = ::write(fd, peek(), readableBytes());
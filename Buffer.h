@@ -1,8 +1,17 @@
 #pragma once
 
-#include <vector>
 #include <string>
+#include <memory>
 #include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+#include <sys/types.h>
+
+#include "StringPiece.h"
+#include "ByteSearch.h"
+
+class BufferPool;
 
 // 网络库底层的缓冲器类型定义
 class Buffer
@@ -10,11 +19,24 @@ class Buffer
 public:
     static const size_t kCheapPrepend = 8; // 初始预留的prependabel_空间大小
     static const size_t kInitialSize = 1024;
+    // 自适应读取大小的范围 见readFd
+    static const size_t kMinReadHint = 256;
+    static const size_t kMaxReadHint = 64 * 1024 - kCheapPrepend; // 加上预留空间正好是BufferPool最大的一级
 
-    explicit Buffer(size_t initalSize = kInitialSize)
-        : buffer_(kCheapPrepend + initalSize), readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend)
-    {
-    }
+    // 构造时不申请内存 第一次写入时才按照initalSize申请 数据全部读完(retrieveAll)后释放
+    // 空闲的Buffer只占对象本身的几十个字节
+    explicit Buffer(size_t initalSize = kInitialSize);
+    // 从pool中申请和归还内存
+    // 只有pool所属的loop线程会用到空闲链表 其它线程退化为malloc/free
+    // Buffer持有pool的引用 loop先析构也不影响Buffer的析构
+    explicit Buffer(const std::shared_ptr<BufferPool> &pool, size_t initalSize = kInitialSize);
+    ~Buffer();
+
+    Buffer(const Buffer &other);
+    Buffer& operator=(const Buffer &other);
+    Buffer(Buffer &&other);
+    Buffer& operator=(Buffer &&other);
+    void swap(Buffer &other);
 
     size_t readableBytes() const
     {
@@ -22,17 +44,56 @@ public:
     }
     size_t writableBytes() const
     {
-        return buffer_.size() - writerIndex_;
+        return capacity_ > writerIndex_ ? capacity_ - writerIndex_ : 0;
     }
     size_t prependableBytes() const
     {
         return readerIndex_;
     }
+    // 底层内存的大小 还没有申请时为0
+    size_t capacity() const { return capacity_; }
 
     // 返回缓冲区中可读数据的起始地址
+    // 还没有申请内存时返回一个静态的空数组 不对空指针做偏移 peek()和beginWrite()相等
     const char *peek() const
     {
-        return begin() + readerIndex_;
+        return data_ ? data_ + readerIndex_ : kEmptyData;
+    }
+
+    // 可读数据的视图 不拷贝 在下一次修改Buffer之前有效
+    // 解析协议时直接在视图上查找分隔符 确定消息边界后再retrieve
+    StringPiece toStringPiece() const
+    {
+        return StringPiece(peek(), readableBytes());
+    }
+
+    // 丢弃[peek(), end)之间的数据 end通常是在toStringPiece()上查找得到的位置
+    void retrieveUntil(const char *end)
+    {
+        retrieve(end - peek());
+    }
+
+    /*
+     * 在可读数据中查找分隔符 返回分隔符的位置 找不到返回nullptr
+     * offset是相对peek()的起始位置 数据还没收全时可以记下已经查过的长度 下次从这里继续 不用从头再查
+     * findCRLF返回'\r'的位置 续查时offset应当退回一个字节(最后一个字节可能是'\r')
+     */
+    const char* findCRLF(size_t offset = 0) const
+    {
+        return offset < readableBytes() ? searchCRLF(peek() + offset, beginWrite()) : nullptr;
+    }
+    const char* findEOL(size_t offset = 0) const
+    {
+        return findChar('\n', offset);
+    }
+    const char* findChar(char c, size_t offset = 0) const
+    {
+        return offset < readableBytes() ? searchChar(peek() + offset, beginWrite(), c) : nullptr;
+    }
+    // chars是以'\0'结尾的字节集合 不超过8个字节时使用向量化的比较
+    const char* findAny(const char *chars, size_t offset = 0) const
+    {
+        return offset < readableBytes() ? searchAny(peek() + offset, beginWrite(), chars) : nullptr;
     }
 
     // onMessage string <- Buffer
@@ -52,6 +113,10 @@ public:
     {
         readerIndex_ = kCheapPrepend;
         writerIndex_ = kCheapPrepend;
+        if (data_)
+        {
+            release(); // 读空后马上释放内存 下次写入时再申请 池化的缓冲区只是在空闲链表中进出
+        }
     }
 
     // 把OnMessage函数上报的Buffer数据，转成string类型的数据返回
@@ -67,7 +132,7 @@ public:
         return result;
     }
 
-    // buffer_.size - writerIndex_  len
+    // capacity_ - writerIndex_  len
     void ensureWritableBytes(size_t len)
     {
         if (writableBytes() < len)
@@ -84,48 +149,148 @@ public:
         writerIndex_ += len;
     }
 
-    char *beginWrite() { return begin() + writerIndex_; }
-    const char *beginWrite() const { return begin() + writerIndex_; }
+    // 直接向beginWrite()写入len字节之后调用
+    void hasWritten(size_t len) { writerIndex_ += len; }
 
-    // 从fd上读取数据
-    ssize_t readFd(int fd, int *saveErrno);
-    // 通过fd发送数据
-    ssize_t writeFd(int fd, int *saveErrno);
-private:
-    char *begin()
+    /*
+     * 整数的读写 统一使用网络字节序(大端)
+     * appendIntXX 追加到可读数据的末尾
+     * peekIntXX   读取可读数据开头的整数 不移动读指针 要求readableBytes() >= sizeof(intXX_t)
+     * readIntXX   读取并移动读指针
+     * prependIntXX 写到可读数据的前面 用于在消息体写好之后补上长度头
+     */
+    void appendInt64(int64_t x)
+    {
+        int64_t be64 = static_cast<int64_t>(htobe64(static_cast<uint64_t>(x)));
+        append(reinterpret_cast<const char*>(&be64), sizeof be64);
+    }
+    void appendInt32(int32_t x)
+    {
+        int32_t be32 = static_cast<int32_t>(htobe32(static_cast<uint32_t>(x)));
+        append(reinterpret_cast<const char*>(&be32), sizeof be32);
+    }
+    void appendInt16(int16_t x)
     {
-        // it.operator*()
-        return &*buffer_.begin(); // vector底层数组首元素的地址，也就是数组的起始地址
+        int16_t be16 = static_cast<int16_t>(htobe16(static_cast<uint16_t>(x)));
+        append(reinterpret_cast<const char*>(&be16), sizeof be16);
     }
-    const char *begin() const
+    void appendInt8(int8_t x)
     {
-        return &*buffer_.begin();
+        append(reinterpret_cast<const char*>(&x), sizeof x);
     }
 
-    void makeSpace(size_t len)
+    int64_t peekInt64() const
     {
-       /**
-         * | kCheapPrepend |xxx| reader | writer |                     // xxx标示reader中已读的部分
-         * | kCheapPrepend | reader ｜          len          |
-         **/ 
-        if (writableBytes() + prependableBytes() < len + kCheapPrepend) //
-        {
-            buffer_.resize(writerIndex_ + len);
-        }
-        else    // 这里说明 len <= xxx + writer 把reader搬到从xxx开始 使得xxx后面是一段连续空间
+        uint64_t be64 = 0;
+        ::memcpy(&be64, peek(), sizeof be64);
+        return static_cast<int64_t>(be64toh(be64));
+    }
+    int32_t peekInt32() const
+    {
+        uint32_t be32 = 0;
+        ::memcpy(&be32, peek(), sizeof be32);
+        return static_cast<int32_t>(be32toh(be32));
+    }
+    int16_t peekInt16() const
+    {
+        uint16_t be16 = 0;
+        ::memcpy(&be16, peek(), sizeof be16);
+        return static_cast<int16_t>(be16toh(be16));
+    }
+    int8_t peekInt8() const
+    {
+        return static_cast<int8_t>(*peek());
+    }
+
+    int64_t readInt64()
+    {
+        int64_t result = peekInt64();
+        retrieve(sizeof result);
+        return result;
+    }
+    int32_t readInt32()
+    {
+        int32_t result = peekInt32();
+        retrieve(sizeof result);
+        return result;
+    }
+    int16_t readInt16()
+    {
+        int16_t result = peekInt16();
+        retrieve(sizeof result);
+        return result;
+    }
+    int8_t readInt8()
+    {
+        int8_t result = peekInt8();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    // 把[data, data+len]写到可读数据的前面 通常使用kCheapPrepend预留的空间 不够时把可读数据往后挪
+    void prepend(const void *data, size_t len)
+    {
+        if (len > prependableBytes() || data_ == nullptr)
         {
-            size_t readable = readableBytes(); // readable = reader的长度
-            // 将当前缓冲区中从readerIndex_到writerIndex_的数据
-            // 拷贝到缓冲区起始位置kCheapPrepend处，以便腾出更多的可写空间
-            std::copy(begin() + readerIndex_,
-                      begin() + writerIndex_,
-                      begin() + kCheapPrepend);
-            readerIndex_ = kCheapPrepend;
-            writerIndex_ = readerIndex_ + readable; 
+            makePrependSpace(len);
         }
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
     }
 
-    std::vector<char> buffer_;
+    void prependInt64(int64_t x)
+    {
+        int64_t be64 = static_cast<int64_t>(htobe64(static_cast<uint64_t>(x)));
+        prepend(&be64, sizeof be64);
+    }
+    void prependInt32(int32_t x)
+    {
+        int32_t be32 = static_cast<int32_t>(htobe32(static_cast<uint32_t>(x)));
+        prepend(&be32, sizeof be32);
+    }
+    void prependInt16(int16_t x)
+    {
+        int16_t be16 = static_cast<int16_t>(htobe16(static_cast<uint16_t>(x)));
+        prepend(&be16, sizeof be16);
+    }
+    void prependInt8(int8_t x)
+    {
+        prepend(&x, sizeof x);
+    }
+
+    // 释放多余的内存 只保留可读数据和reserve字节的可写空间
+    // 没有可读数据并且reserve为0时释放全部内存 下次写入时重新申请
+    void shrink(size_t reserve);
+
+    // 写入之前先ensureWritableBytes 还没有申请内存时与peek()一样指向静态的空数组 不能写入
+    char *beginWrite() { return data_ ? data_ + writerIndex_ : kEmptyData; }
+    const char *beginWrite() const { return data_ ? data_ + writerIndex_ : kEmptyData; }
+
+    // 从fd上读取数据
+    // 可写空间不够时超出的部分先读到scratch中再追加 scratch的内容不需要初始化
+    // 通常传入所属loop的EventLoop::readScratch() 为空时使用栈上的64KB
+    ssize_t readFd(int fd, int *saveErrno, char *scratch = nullptr, size_t scratchSize = 0);
+    // 通过fd发送数据
+    ssize_t writeFd(int fd, int *saveErrno);
+private:
+    char *begin() { return data_; }
+    const char *begin() const { return data_; }
+
+    // 扩容或者把可读数据搬到头部 保证至少有len字节可写
+    void makeSpace(size_t len);
+    // 保证前面至少有len字节的空间可以prepend
+    void makePrependSpace(size_t len);
+    // 释放底层内存 只能在没有可读数据时调用
+    void release();
+    void updateReadHint(size_t nread, size_t offered);
+
+    static char kEmptyData[1]; // 空Buffer的peek()/beginWrite() 永远不会被写入
+
+    std::shared_ptr<BufferPool> pool_; // 为空时直接使用malloc/free
+    char *data_;
+    size_t capacity_;
+    size_t initialSize_;  // 第一次申请内存时的大小(不含kCheapPrepend)
     size_t readerIndex_;
     size_t writerIndex_;
-};
\ No newline at end of file
+    size_t readHint_;     // 根据最近几次readFd的结果估计的单次读取量
+};
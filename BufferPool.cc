@@ -0,0 +1,139 @@
+#include "BufferPool.h"
+#include "CurrentThread.h"
+
+#include <stdlib.h>
+
+BufferPool::BufferPool(pid_t threadId)
+    : threadId_(threadId)
+    , cachedBytes_(0)
+    , maxCachedBytes_(kDefaultMaxCachedBytes)
+    , hits_(0)
+    , misses_(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    for (int i = 0; i < kNumClasses; ++i)
+    {
+        for (char *data : freeLists_[i])
+        {
+            ::free(data);
+        }
+    }
+}
+
+void BufferPool::detach()
+{
+    // 先清掉线程id 其它线程看到0之后不会再进入空闲链表
+    threadId_ = 0;
+    for (int i = 0; i < kNumClasses; ++i)
+    {
+        for (char *data : freeLists_[i])
+        {
+            ::free(data);
+        }
+        std::vector<char*>().swap(freeLists_[i]);
+    }
+    cachedBytes_ = 0;
+}
+
+bool BufferPool::isInOwnerThread() const
+{
+    return threadId_.load(std::memory_order_relaxed) == CurrentThread::tid();
+}
+
+void BufferPool::setMaxCachedBytes(size_t bytes)
+{
+    maxCachedBytes_ = bytes;
+    // 从大块开始释放
+    for (int i = kNumClasses - 1; i >= 0 && cachedBytes_ > maxCachedBytes_; --i)
+    {
+        std::vector<char*> &freeList = freeLists_[i];
+        while (!freeList.empty() && cachedBytes_ > maxCachedBytes_)
+        {
+            ::free(freeList.back());
+            freeList.pop_back();
+            cachedBytes_ -= classSize(i);
+        }
+    }
+}
+
+int BufferPool::sizeClass(size_t size)
+{
+    int index = 0;
+    size_t blockSize = kMinBlockSize;
+    while (blockSize < size)
+    {
+        blockSize <<= 1;
+        ++index;
+    }
+    return index < kNumClasses ? index : -1;
+}
+
+char* BufferPool::allocate(size_t size, size_t *capacity)
+{
+    int index = sizeClass(size);
+    if (index < 0)
+    {
+        *capacity = size;
+        return static_cast<char*>(::malloc(size));
+    }
+
+    *capacity = classSize(index);
+    if (isInOwnerThread())
+    {
+        std::vector<char*> &freeList = freeLists_[index];
+        if (!freeList.empty())
+        {
+            char *data = freeList.back();
+            freeList.pop_back();
+            cachedBytes_ -= *capacity;
+            ++hits_;
+            return data;
+        }
+        ++misses_;
+    }
+    return static_cast<char*>(::malloc(*capacity));
+}
+
+void BufferPool::deallocate(char *data, size_t capacity)
+{
+    if (data == nullptr)
+    {
+        return;
+    }
+    int index = sizeClass(capacity);
+    // 先判断线程 其它线程不能读写空闲链表和计数
+    if (isInOwnerThread()
+        && index >= 0 && classSize(index) == capacity
+        && cachedBytes_ + capacity <= maxCachedBytes_)
+    {
+        freeLists_[index].push_back(data);
+        cachedBytes_ += capacity;
+        return;
+    }
+    ::free(data);
+}
+
+char* BufferPool::allocate(BufferPool *pool, size_t size, size_t *capacity)
+{
+    if (pool)
+    {
+        return pool->allocate(size, capacity);
+    }
+    *capacity = size;
+    return static_cast<char*>(::malloc(size));
+}
+
+void BufferPool::deallocate(BufferPool *pool, char *data, size_t capacity)
+{
+    if (pool)
+    {
+        pool->deallocate(data, capacity);
+    }
+    else
+    {
+        ::free(data);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+
+/*
+ * 每个EventLoop一个的缓冲区内存池 按大小分级缓存释放的内存块
+ * - 分级：1KB 2KB 4KB ... 64KB 申请的大小向上取整到所在级别 超过64KB直接malloc
+ * - 只有所属loop线程访问空闲链表 不需要加锁
+ *   其它线程(例如在用户线程中析构的TcpConnection)申请和释放时直接走malloc/free
+ *   池中的内存块本身也是malloc出来的 所以在哪个线程释放都是安全的
+ * - 缓存的总字节数有上限 超过上限的块直接free 避免连接高峰过后一直占着内存
+ * - 由EventLoop和各个Buffer/ChainBuffer通过shared_ptr共同持有 不依赖EventLoop的生命周期
+ *   loop析构时调用detach 释放缓存并且不再使用空闲链表 之后还活着的缓冲区(例如用户持有的
+ *   TcpConnectionPtr)析构时直接free
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kMinBlockSize = 1024;
+    static const size_t kMaxBlockSize = 64 * 1024;
+    static const int kNumClasses = 7;
+    static const size_t kDefaultMaxCachedBytes = 16 * 1024 * 1024;
+
+    // threadId为所属loop的线程 只有这个线程会访问空闲链表
+    explicit BufferPool(pid_t threadId);
+    ~BufferPool();
+
+    // 所属的loop析构时在loop线程中调用 释放所有缓存 之后的申请和归还都直接走malloc/free
+    void detach();
+
+    // 申请至少size字节 通过capacity返回实际可用的大小
+    char* allocate(size_t size, size_t *capacity);
+    // 归还allocate得到的内存 capacity必须是allocate返回的值
+    void deallocate(char *data, size_t capacity);
+
+    // pool为空时退化为malloc/free 供Buffer/ChainBuffer统一调用
+    static char* allocate(BufferPool *pool, size_t size, size_t *capacity);
+    static void deallocate(BufferPool *pool, char *data, size_t capacity);
+
+    // 设置缓存的上限 超出的部分马上释放 只能在所属loop线程调用
+    void setMaxCachedBytes(size_t bytes);
+    size_t maxCachedBytes() const { return maxCachedBytes_; }
+    size_t cachedBytes() const { return cachedBytes_; }
+    // 从空闲链表直接拿到内存块的次数和需要malloc的次数
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    // size所在的级别 超过最大级别返回-1
+    static int sizeClass(size_t size);
+    static size_t classSize(int index) { return kMinBlockSize << index; }
+
+    bool isInOwnerThread() const;
+
+    std::atomic<pid_t> threadId_; // 所属loop的线程 detach之后为0
+    std::vector<char*> freeLists_[kNumClasses];
+    size_t cachedBytes_;
+    size_t maxCachedBytes_;
+    uint64_t hits_;
+    uint64_t misses_;
+};
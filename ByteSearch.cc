@@ -0,0 +1,212 @@
+#include "ByteSearch.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MUDUO_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // 逐字节的实现 处理向量化之后剩下的尾部 也是非x86平台的实现
+    // memchr本身由glibc做了向量化
+    const char* scalarChar(const char *begin, const char *end, char c)
+    {
+        return static_cast<const char*>(::memchr(begin, c, end - begin));
+    }
+
+    const char* scalarAny(const char *begin, const char *end, const char *chars)
+    {
+        bool table[256] = {false};
+        for (const char *p = chars; *p; ++p)
+        {
+            table[static_cast<unsigned char>(*p)] = true;
+        }
+        for (const char *p = begin; p < end; ++p)
+        {
+            if (table[static_cast<unsigned char>(*p)])
+            {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    const char* scalarCRLF(const char *begin, const char *end)
+    {
+        for (const char *p = begin; p + 1 < end; ++p)
+        {
+            p = static_cast<const char*>(::memchr(p, '\r', end - 1 - p));
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+            if (p[1] == '\n')
+            {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    // 向量化的searchAny最多比较这么多个字节 更多时使用查表
+    const size_t kMaxVectorSet = 8;
+
+#ifdef MUDUO_SEARCH_X86
+    const char* sse2Any(const char *begin, const char *end, const char *chars)
+    {
+        size_t n = ::strlen(chars);
+        if (n == 0 || n > kMaxVectorSet)
+        {
+            return scalarAny(begin, end, chars);
+        }
+        __m128i needles[kMaxVectorSet];
+        for (size_t i = 0; i < n; ++i)
+        {
+            needles[i] = _mm_set1_epi8(chars[i]);
+        }
+        const char *p = begin;
+        for (; p + 16 <= end; p += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hit = _mm_cmpeq_epi8(block, needles[0]);
+            for (size_t i = 1; i < n; ++i)
+            {
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, needles[i]));
+            }
+            int mask = _mm_movemask_epi8(hit);
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return scalarAny(p, end, chars);
+    }
+
+    // 同时比较p处的'\r'和p+1处的'\n' 两个条件的掩码相与
+    const char* sse2CRLF(const char *begin, const char *end)
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const char *p = begin;
+        for (; p + 17 <= end; p += 16)
+        {
+            __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+            int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, cr),
+                                                       _mm_cmpeq_epi8(second, lf)));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return scalarCRLF(p, end);
+    }
+
+    __attribute__((target("avx2")))
+    const char* avx2Any(const char *begin, const char *end, const char *chars)
+    {
+        size_t n = ::strlen(chars);
+        if (n == 0 || n > kMaxVectorSet)
+        {
+            return scalarAny(begin, end, chars);
+        }
+        __m256i needles[kMaxVectorSet];
+        for (size_t i = 0; i < n; ++i)
+        {
+            needles[i] = _mm256_set1_epi8(chars[i]);
+        }
+        const char *p = begin;
+        for (; p + 32 <= end; p += 32)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i hit = _mm256_cmpeq_epi8(block, needles[0]);
+            for (size_t i = 1; i < n; ++i)
+            {
+                hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, needles[i]));
+            }
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return sse2Any(p, end, chars);
+    }
+
+    __attribute__((target("avx2")))
+    const char* avx2CRLF(const char *begin, const char *end)
+    {
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const char *p = begin;
+        for (; p + 33 <= end; p += 32)
+        {
+            __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(first, cr), _mm256_cmpeq_epi8(second, lf))));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return sse2CRLF(p, end);
+    }
+#endif
+
+    struct SearchImpl
+    {
+        const char* (*findAny)(const char*, const char*, const char*);
+        const char* (*findCRLF)(const char*, const char*);
+        const char *name;
+    };
+
+    SearchImpl selectImpl()
+    {
+#ifdef MUDUO_SEARCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            SearchImpl impl = { avx2Any, avx2CRLF, "avx2" };
+            return impl;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            SearchImpl impl = { sse2Any, sse2CRLF, "sse2" };
+            return impl;
+        }
+#endif
+        SearchImpl impl = { scalarAny, scalarCRLF, "scalar" };
+        return impl;
+    }
+
+    // 第一次使用时检测CPU 之后只是一次函数指针调用
+    const SearchImpl& impl()
+    {
+        static const SearchImpl searchImpl = selectImpl();
+        return searchImpl;
+    }
+}
+
+// 单个字节直接用memchr glibc已经按CPU选择了向量化的实现 比这里自己写的循环展开得更充分
+const char* searchChar(const char *begin, const char *end, char c)
+{
+    return begin < end ? scalarChar(begin, end, c) : nullptr;
+}
+
+const char* searchAny(const char *begin, const char *end, const char *chars)
+{
+    return begin < end ? impl().findAny(begin, end, chars) : nullptr;
+}
+
+const char* searchCRLF(const char *begin, const char *end)
+{
+    return begin + 1 < end ? impl().findCRLF(begin, end) : nullptr;
+}
+
+const char* searchImplName()
+{
+    return impl().name;
+}
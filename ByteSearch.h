@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * 在[begin, end)中查找分隔符 找不到返回nullptr
+ * x86上根据CPU在运行时选择AVX2或者SSE2的实现 其它平台使用逐字节比较
+ * 单个字节的查找直接使用memchr(glibc内部已经按CPU分派)
+ * Buffer的findCRLF/findEOL/findChar/findAny基于这些函数
+ */
+
+// 查找字节c
+const char* searchChar(const char *begin, const char *end, char c);
+// 查找chars中任意一个字节 chars以'\0'结尾
+const char* searchAny(const char *begin, const char *end, const char *chars);
+// 查找"\r\n" 返回'\r'的位置
+const char* searchCRLF(const char *begin, const char *end);
+
+// 当前使用的实现 "avx2" "sse2"或者"scalar"
+const char* searchImplName();
@@ -18,4 +18,11 @@ using WriteCompleteCallback = std::function<void (const TcpConnectionPtr&)>;
 using MessageCallback = std::function<void (const TcpConnectionPtr&,
                                         Buffer*,
                                         Timestamp)>;
-using HighWaterMarkCallback = std::function<void (const TcpConnectionPtr&, size_t)>;
\ No newline at end of file
+using HighWaterMarkCallback = std::function<void (const TcpConnectionPtr&, size_t)>;
+// sendFile的完成回调 finished为false表示连接在发完之前已经断开
+using SendFileCallback = std::function<void (const TcpConnectionPtr&, bool finished)>;
+// 内核完成了completed次零拷贝发送 对应的payload引用已经释放
+// copied为true表示内核实际上退回了拷贝(例如对端在本机) 零拷贝没有带来好处
+using ZeroCopyCallback = std::function<void (const TcpConnectionPtr&, size_t completed, bool copied)>;
+
+using TimerCallback = std::function<void()>;
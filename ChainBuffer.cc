@@ -0,0 +1,303 @@
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+ChainBuffer::ChainBuffer(const std::shared_ptr<BufferPool> &pool)
+    : pool_(pool)
+    , head_(0)
+    , finishedFiles_(0)
+    , fileFailed_(false)
+    , readable_(0)
+    , zeroCopyThreshold_(0)
+    , zeroCopySeq_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    retrieveAll();
+}
+
+void ChainBuffer::appendBlock(size_t size)
+{
+    Block block;
+    block.data = BufferPool::allocate(pool_.get(), size, &block.capacity);
+    block.readIndex = 0;
+    block.writeIndex = 0;
+    block.fd = -1;
+    blocks_.push_back(std::move(block));
+}
+
+void ChainBuffer::append(const PayloadPtr &payload, size_t offset)
+{
+    if (!payload || offset >= payload->size())
+    {
+        return;
+    }
+    Block block;
+    block.data = const_cast<char*>(payload->data()); // 只读 writable()为0 不会被写入
+    block.capacity = payload->size();
+    block.readIndex = offset;
+    block.writeIndex = payload->size();
+    block.payload = payload;
+    block.fd = -1;
+    blocks_.push_back(std::move(block));
+    readable_ += payload->size() - offset;
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t len)
+{
+    if (fd < 0 || len == 0)
+    {
+        return;
+    }
+    Block block;
+    block.data = nullptr;
+    block.readIndex = static_cast<size_t>(offset);
+    block.writeIndex = block.readIndex + len;
+    block.capacity = block.writeIndex; // writable()为0 不会被写入
+    block.fd = fd;
+    blocks_.push_back(std::move(block));
+    readable_ += len;
+}
+
+void ChainBuffer::popFrontBlock()
+{
+    Block &front = blocks_[head_];
+    if (front.payload)
+    {
+        front.payload.reset();
+    }
+    else
+    {
+        BufferPool::deallocate(pool_.get(), front.data, front.capacity);
+    }
+    ++head_;
+    if (head_ == blocks_.size())
+    {
+        std::vector<Block>().swap(blocks_); // 全部发完 释放索引数组
+        head_ = 0;
+    }
+    else if (head_ >= 16 && head_ * 2 >= blocks_.size())
+    {
+        // 已经读完的块占了一半以上时压缩一次 均摊下来每个块只移动常数次
+        blocks_.erase(blocks_.begin(), blocks_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+const char *ChainBuffer::peek() const
+{
+    if (!hasBlocks())
+    {
+        return nullptr;
+    }
+    const Block &front = blocks_[head_];
+    return front.data + front.readIndex;
+}
+
+size_t ChainBuffer::peekLength() const
+{
+    return hasBlocks() ? blocks_[head_].readable() : 0;
+}
+
+size_t ChainBuffer::nextBlockSize() const
+{
+    return readable_ < kLargeThreshold ? kSmallBlockSize : kLargeBlockSize;
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    while (len > 0)
+    {
+        if (!hasBlocks() || blocks_.back().writable() == 0)
+        {
+            appendBlock(nextBlockSize());
+        }
+        Block &back = blocks_.back();
+        size_t n = std::min(len, back.writable());
+        ::memcpy(back.data + back.writeIndex, data, n);
+        back.writeIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    len = std::min(len, readable_);
+    readable_ -= len;
+    while (len > 0)
+    {
+        Block &front = blocks_[head_];
+        size_t n = std::min(len, front.readable());
+        front.readIndex += n;
+        len -= n;
+        if (front.readable() == 0)
+        {
+            if (front.fd >= 0)
+            {
+                ++finishedFiles_;
+            }
+            popFrontBlock();
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    while (hasBlocks())
+    {
+        popFrontBlock();
+    }
+    readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len)
+{
+    len = std::min(len, readable_);
+    std::string result;
+    result.reserve(len);
+    size_t left = len;
+    for (std::vector<Block>::const_iterator it = blocks_.begin() + head_; left > 0 && it != blocks_.end(); ++it)
+    {
+        size_t n = std::min(left, it->readable());
+        if (it->fd >= 0)
+        {
+            size_t pos = result.size();
+            result.resize(pos + n);
+            ssize_t nread = ::pread(it->fd, &result[pos], n, static_cast<off_t>(it->readIndex));
+            result.resize(pos + (nread > 0 ? static_cast<size_t>(nread) : 0));
+        }
+        else
+        {
+            result.append(it->data + it->readIndex, n);
+        }
+        left -= n;
+    }
+    retrieve(len);
+    return result;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno)
+{
+    struct iovec vec[IOV_MAX];
+    ssize_t total = 0;
+    bool zeroCopyFailed = false;
+    while (readable_ > 0)
+    {
+        ssize_t n = 0;
+        size_t attempted = 0;
+        const Block &front = blocks_[head_];
+        if (front.fd >= 0)
+        {
+            // 文件段 由内核直接从page cache发到socket
+            off_t offset = static_cast<off_t>(front.readIndex);
+            attempted = front.readable();
+            n = ::sendfile(fd, front.fd, &offset, attempted);
+            // n为0表示文件比声明的长度短 剩下的部分永远发不出去
+            // EBADF/EINVAL/ESPIPE等错误再试也不会好 留在队首的话EPOLLOUT会一直触发
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+            {
+                *saveErrno = n == 0 ? EINVAL : errno;
+                readable_ -= front.readable();
+                ++finishedFiles_;
+                fileFailed_ = true;
+                popFrontBlock();
+                return total > 0 ? total : -1;
+            }
+        }
+        else if (useZeroCopy(front) && !zeroCopyFailed)
+        {
+            vec[0].iov_base = front.data + front.readIndex;
+            vec[0].iov_len = front.readable();
+            attempted = front.readable();
+            struct msghdr msg;
+            ::memset(&msg, 0, sizeof msg);
+            msg.msg_iov = vec;
+            msg.msg_iovlen = 1;
+            n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+            if (n > 0)
+            {
+                // 内核引用了payload的内存 在完成通知之前不能释放
+                ZeroCopyHold hold = { zeroCopySeq_++, front.payload };
+                zeroCopyHolds_.push_back(hold);
+            }
+            else if (n < 0 && errno == ENOBUFS)
+            {
+                // 超过了optmem的限制 这一次退回普通的拷贝发送
+                zeroCopyFailed = true;
+                continue;
+            }
+        }
+        else
+        {
+            // 连续的内存块 遇到文件段或者要零拷贝发送的块为止
+            int iovcnt = 0;
+            for (std::vector<Block>::iterator it = blocks_.begin() + head_;
+                 it != blocks_.end() && it->fd < 0 && iovcnt < IOV_MAX
+                 && (iovcnt == 0 || !useZeroCopy(*it)); ++it)
+            {
+                vec[iovcnt].iov_base = it->data + it->readIndex;
+                vec[iovcnt].iov_len = it->readable();
+                attempted += it->readable();
+                ++iovcnt;
+            }
+            n = ::writev(fd, vec, iovcnt);
+        }
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (total == 0)
+            {
+                *saveErrno = errno;
+                return -1;
+            }
+            break; // 已经写出了一部分 错误留到下一次写时处理
+        }
+        retrieve(n);
+        total += n;
+        if (static_cast<size_t>(n) < attempted) // 发送缓冲区满了 再写只会得到EAGAIN
+        {
+            break;
+        }
+    }
+    return total;
+}
+
+size_t ChainBuffer::completeZeroCopy(uint32_t lo, uint32_t hi)
+{
+    // 序号是32位的 可能回绕 用无符号减法判断是否在区间内
+    size_t released = 0;
+    std::vector<ZeroCopyHold>::iterator it = zeroCopyHolds_.begin();
+    while (it != zeroCopyHolds_.end())
+    {
+        if (it->seq - lo <= hi - lo)
+        {
+            it = zeroCopyHolds_.erase(it);
+            ++released;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (zeroCopyHolds_.empty())
+    {
+        std::vector<ZeroCopyHold>().swap(zeroCopyHolds_);
+    }
+    return released;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <sys/types.h>
+#include <string>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "Payload.h"
+
+class BufferPool;
+
+/*
+ * 由固定大小的块串起来的缓冲区 用作TcpConnection的发送缓冲区
+ * - append只会向末尾的块写入或者在末尾追加新块 已有的数据不会被移动或者拷贝
+ * - retrieve读完一整块就把这一块释放掉 不需要像Buffer那样把剩余数据搬到头部
+ * - 积压较少时使用4KB的小块 积压超过kLargeThreshold后使用64KB的大块
+ * 慢速的对端导致积压几十MB时 每次send的代价只和新数据的长度有关
+ * 块的内存从所属loop的BufferPool中申请 块读完后归还
+ * 发送完所有数据后连块的索引数组也一起释放 空闲的连接不占用任何内存
+ * 除了自己的数据块 还可以按引用加入共享的Payload 多个连接发送同一份数据时不需要各自拷贝
+ */
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kSmallBlockSize = 4 * 1024;
+    static const size_t kLargeBlockSize = 64 * 1024;
+    static const size_t kLargeThreshold = 64 * 1024;
+
+    explicit ChainBuffer(const std::shared_ptr<BufferPool> &pool = std::shared_ptr<BufferPool>());
+    ~ChainBuffer();
+
+    size_t readableBytes() const { return readable_; }
+    size_t numBlocks() const { return blocks_.size() - head_; }
+
+    // 第一块中可读数据的起始地址和长度 数据不一定连续 需要按块访问
+    const char *peek() const;
+    size_t peekLength() const;
+
+    void append(const char *data, size_t len);
+    void append(const std::string &str) { append(str.data(), str.size()); }
+    // 把payload从offset开始的部分按引用加入队列 不拷贝数据 发完后释放引用
+    void append(const PayloadPtr &payload, size_t offset = 0);
+    // 把文件fd中[offset, offset+len)加入队列 发送时用sendfile 数据不经过用户态
+    // fd由调用者负责关闭 在这一段发完或者队列被清空之前必须保持打开
+    void appendFile(int fd, off_t offset, size_t len);
+
+    // 自上次调用以来结束的文件段个数 按加入的顺序结束
+    // failed为true表示其中最后一段因为sendfile出错被丢弃 没有完整发出
+    size_t takeFinishedFiles(bool *failed)
+    {
+        size_t n = finishedFiles_;
+        *failed = fileFailed_;
+        finishedFiles_ = 0;
+        fileFailed_ = false;
+        return n;
+    }
+
+    // 丢弃前len个字节 读完的块直接释放
+    void retrieve(size_t len);
+    // 清空队列 其中没有发完的文件段不计入takeFinishedFiles
+    void retrieveAll();
+
+    // 拷贝出前len个字节
+    std::string retrieveAsString(size_t len);
+    std::string retrieveAllAsString() { return retrieveAsString(readable_); }
+
+    /*
+     * 零拷贝发送 fd需要已经开启SO_ZEROCOPY 0表示关闭(默认)
+     * 开启后不小于bytes的payload块用sendmsg(MSG_ZEROCOPY)单独发送 内核直接引用payload的内存
+     * 每次这样的发送在内核中有一个递增的序号 payload的引用保留到对应序号的完成通知到达为止
+     */
+    void setZeroCopyThreshold(size_t bytes) { zeroCopyThreshold_ = bytes; }
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    // 处理内核的完成通知 释放序号在[lo, hi]中的payload引用 返回释放的个数
+    size_t completeZeroCopy(uint32_t lo, uint32_t hi);
+    // 还在等待内核完成通知的零拷贝发送个数
+    // 析构时会释放所有的payload引用 不为0时调用者要等通知全部到达后再析构 否则内核可能发出被复用的内存
+    size_t zeroCopyInFlight() const { return zeroCopyHolds_.size(); }
+
+    /*
+     * 通过fd发送数据 每次把最多IOV_MAX块收集到一个writev中 直到发完或者socket发送缓冲区满
+     * 遇到文件段时改用sendfile 开启零拷贝时大的payload块改用sendmsg(MSG_ZEROCOPY)
+     * sendfile出现不可恢复的错误(fd无效、不支持sendfile、文件变短)时丢弃这一段并立即返回
+     * 通过takeFinishedFiles报告失败 连接上的字节流已经不完整 调用者应该关闭连接
+     * 与Buffer::writeFd不同 写出的部分已经retrieve
+     * 返回写出的总字节数 一个字节都没有写出时返回-1并通过saveErrno返回错误码
+     */
+    ssize_t writeFd(int fd, int *saveErrno);
+
+private:
+    struct Block
+    {
+        size_t readable() const { return writeIndex - readIndex; }
+        size_t writable() const { return capacity - writeIndex; }
+
+        char *data;
+        size_t capacity;
+        size_t readIndex;
+        size_t writeIndex;
+        // 非空表示这一块引用的是共享的payload 不是从pool申请的 也不能再往里追加
+        PayloadPtr payload;
+        // 不小于0表示这一块是文件段 readIndex/writeIndex是文件中的偏移 data为空
+        int fd;
+    };
+
+    // 已经交给内核零拷贝发送的payload 等待完成通知
+    struct ZeroCopyHold
+    {
+        uint32_t seq;
+        PayloadPtr payload;
+    };
+
+    // 这一块是否要用零拷贝发送
+    bool useZeroCopy(const Block &block) const
+    {
+        return zeroCopyThreshold_ > 0 && block.payload && block.readable() >= zeroCopyThreshold_;
+    }
+
+    void appendBlock(size_t size);
+    void popFrontBlock();
+
+    // 新块的大小 根据当前的积压量选择
+    size_t nextBlockSize() const;
+
+    bool hasBlocks() const { return head_ < blocks_.size(); }
+
+    std::shared_ptr<BufferPool> pool_; // 持有引用 loop先析构时退化为malloc/free
+    // 用vector加上队首下标代替deque libstdc++的deque在构造时就会分配内存
+    std::vector<Block> blocks_;
+    size_t head_; // 第一个还没有读完的块
+    size_t finishedFiles_;
+    bool fileFailed_; // 最后结束的文件段是被丢弃的
+    size_t readable_;
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopySeq_; // 下一次零拷贝发送在内核中的序号
+    std::vector<ZeroCopyHold> zeroCopyHolds_;
+};
@@ -40,16 +40,18 @@ EPollPoller:: ~EPollPoller() // 对应基类中的虚函数
 // 监听poll上的所有事件
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
-    // 由于频繁调用poll 实际上应该使用LOG_DEBUG更合理 当遇到并发场景 关闭DEBUG日志提升效率
-    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, channels_.size());
+    // 频繁调用poll 使用LOG_DEBUG 生产环境编译期即被去掉
+    LOG_DEBUG("func=%s => fd total count:%lu \n", __FUNCTION__, channels_.size());
     // events_.begin()返回的是起始迭代器，解引用就是起始元素，再加个&就是首个元素的地址了。
     int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int saveErrno = errno; // 记录全局变量errno
     Timestamp now(Timestamp::now());
+    // 每次唤醒只取一次时间 缓存起来供本轮事件回调通过Timestamp::cachedNow()读取
+    Timestamp::setCachedNow(now);
 
     if (numEvents > 0)
     {
-        LOG_INFO("%d events happend\n", numEvents); // LOG_DEBUG最合理
+        LOG_DEBUG("%d events happend\n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         if (numEvents == events_.size()) // 返回发生事件的个数和eventlist中的事件个数一样则需要进行扩容
         {
@@ -84,7 +86,7 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 void EPollPoller::updateChannel(Channel *channel)
 {
     const int index = channel->index();
-    LOG_INFO("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_DEBUG("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), index);
 
     if (index == kNew || index == kDeleted) // 未添加或者已删除
     {
@@ -120,7 +122,7 @@ void EPollPoller::removeChannel(Channel *channel)
     int fd = channel->fd();
     channels_.erase(fd);
 
-    LOG_INFO("func=%s => fd = %d\n", __FUNCTION__, fd);
+    LOG_DEBUG("func=%s => fd = %d\n", __FUNCTION__, fd);
 
     int index = channel->index();
     if (index == kAdded) // 该channel已添加，需要从poller移除
@@ -2,6 +2,9 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "BufferPool.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -32,7 +35,10 @@ EventLoop::EventLoop()
     threadId_(CurrentThread::tid()), // 获取当前线程的ID
     poller_(Poller::newDefaultPoller(this)), // 创建一个默认的Poller对象，传入当前EventLoop的指针
     wakeupFd_(createEventfd()),  // 创建一个事件文件描述符
-    wakeupChannel_(new Channel(this, wakeupFd_)) // 创建一个新的Channel对象，用于处理wakeupFd的事件
+    wakeupChannel_(new Channel(this, wakeupFd_)), // 创建一个新的Channel对象，用于处理wakeupFd的事件
+    timerQueue_(new TimerQueue(this)), // 创建定时器队列，timerfd注册到poller上
+    bufferPool_(std::make_shared<BufferPool>(threadId_)), // 缓冲区内存池 开始时是空的
+    callingIterationEndFunctors_(false)
     // currentActiveChannel_(nullptr) // 当前活跃的Channel指针，初始为nullptr
 {
     // 输出调试日志，记录EventLoop对象的地址和所在线程的ID
@@ -63,6 +69,8 @@ EventLoop::~EventLoop()
     wakeupChannel_->remove();   // 删除channel
     ::close(wakeupFd_);
     t_loopInThisThread = nullptr;
+    // 还被缓冲区持有的pool继续存在 但不再缓存内存
+    bufferPool_->detach();
 }
 
 // 开启事件循环
@@ -89,6 +97,7 @@ void EventLoop::loop()
          * mainLoop 实现注册一个回调cb(需要subloop来执行)  wakeup subloop后，执行下面的方法，执行之前mainloop注册的cb操作
          */
         doPendingFunctors();
+        doIterationEndFunctors();
     }
     LOG_INFO("EventLoop %p stop lopping. \n", this);
     looping_ = false;
@@ -121,7 +130,7 @@ void EventLoop::runInLoop(Functor cb)
     }
     else // 在非当前loop线程中执行cb,需要唤醒loop所在线程，执行cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb)); // cb可能带着要发送的数据 移动而不是拷贝
     }
 }
 
@@ -130,14 +139,14 @@ void EventLoop::queueInLoop(Functor cb)
 {
     {
         std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
+        pendingFunctors_.emplace_back(std::move(cb));
     }
         /*
      * 有了 callingPendingFunctors_ 的判断，当 callingPendingFunctors_ 为 true 时，
      * 会再次唤醒线程（即使在同一线程），使得新加入的回调函数能够及时被排入执行队列并尽快执行。
      */
     // 唤醒相应的loop，需要执行上面回调操作的loop的线程了
-    if (!isInLoopThread() || callingPendingFunctors_) 
+    if (!isInLoopThread() || callingPendingFunctors_ || callingIterationEndFunctors_)
 
     {
         wakeup(); // 唤醒所在线程
@@ -171,6 +180,51 @@ void EventLoop::wakeup()
     } 
 }
 
+// 在time时刻执行cb
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+// 在delay秒之后执行cb
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+// 每隔interval秒执行一次cb
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+// 取消定时器
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+// 获取本loop的时间轮 第一次调用时创建
+TimingWheel* EventLoop::timingWheel()
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this));
+    }
+    return timingWheel_.get();
+}
+
+char* EventLoop::readScratch()
+{
+    if (!readScratch_)
+    {
+        readScratch_.reset(new char[kReadScratchSize]); // 不初始化
+    }
+    return readScratch_.get();
+}
+
 // EventLoop的方法 => Poller的方法
 void EventLoop::updateChannel(Channel *channel)
 {
@@ -206,4 +260,26 @@ void EventLoop::doPendingFunctors() // 执行上层回调
         functor(); // 执行当前loop需要执行的回调操作
     }
     callingPendingFunctors_ = false;
-}
\ No newline at end of file
+}
+
+void EventLoop::runAfterIteration(Functor cb)
+{
+    iterationEndFunctors_.push_back(std::move(cb));
+}
+
+void EventLoop::doIterationEndFunctors()
+{
+    if (iterationEndFunctors_.empty())
+    {
+        return;
+    }
+    // 执行过程中新加入的留到下一轮
+    std::vector<Functor> functors;
+    functors.swap(iterationEndFunctors_);
+    callingIterationEndFunctors_ = true;
+    for (const Functor &functor : functors)
+    {
+        functor();
+    }
+    callingIterationEndFunctors_ = false;
+}
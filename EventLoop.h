@@ -12,9 +12,14 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "Callbacks.h"
+#include "TimerId.h"
 
 class Channel;
 class Poller;
+class TimerQueue;
+class TimingWheel;
+class BufferPool;
 
 // 事件循环类 主要包括了两个大模块 Channel  Poller(epoll的抽象)
 
@@ -42,6 +47,31 @@ public:
     // 唤醒loop所在的线程
     void wakeup();
 
+    // 在本轮事件循环的最后(处理完所有事件和pendingFunctors之后)执行cb 只能在loop线程中调用
+    // 用于把本轮中多次产生的工作合并成一次 例如corked连接的输出
+    void runAfterIteration(Functor cb);
+
+    // 定时器 以下接口都是线程安全的 回调在loop线程中执行
+    // 在time时刻执行cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // 在delay秒之后执行cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器
+    void cancel(TimerId timerId);
+
+    // 获取本loop的时间轮 第一次调用时创建 只能在loop线程中调用
+    TimingWheel* timingWheel();
+
+    // 本loop的缓冲区内存池 本loop上的TcpConnection的缓冲区从这里申请内存
+    // 缓冲区共同持有pool 连接在loop析构之后才析构也不会访问已经释放的内存
+    const std::shared_ptr<BufferPool>& bufferPool() const { return bufferPool_; }
+
+    // 本loop上所有连接readFd共用的临时区域 第一次调用时分配 内容不会被清零 只能在loop线程中使用
+    static const size_t kReadScratchSize = 64 * 1024;
+    char* readScratch();
+
     // EventLoop的方法 => Poller的方法
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
@@ -53,6 +83,7 @@ public:
 private:
     void handleRead();        // 给eventfd返回的文件描述符wakeupFd_绑定的事件回调  
     void doPendingFunctors(); // 执行上层回调
+    void doIterationEndFunctors();
 
     using ChannelList = std::vector<Channel*>;
 
@@ -67,11 +98,20 @@ private:
     // mainReactor-轮询-唤醒-subReactor
     int wakeupFd_; // 主要作用：当mainLoop获取一个新用户的channel，需通过轮询算法选择一个subLoop，通过该成员唤醒subLoop
     std::unique_ptr<Channel> wakeupChannel_;
+    // 定时器队列 必须在poller_和wakeupChannel_之后构造
+    std::unique_ptr<TimerQueue> timerQueue_;
+    // 空闲超时使用的时间轮 析构时需要取消定时器 必须在timerQueue_之后声明
+    std::unique_ptr<TimingWheel> timingWheel_;
+    std::shared_ptr<BufferPool> bufferPool_;
+    std::unique_ptr<char[]> readScratch_;
 
     ChannelList activeChannels_;
     // Channel *currentActiveChannel_;
     std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有需要执行的回调操作
     std::vector<Functor> pendingFunctors_; // 存储loop需要执行的所有的回调操作
     std::mutex mutex_; // 互斥锁，用来保护上面vector容器的线程安全操作
+    std::vector<Functor> iterationEndFunctors_; // 本轮结束时执行 只在loop线程中访问
+    // 正在执行iterationEndFunctors_ 这时queueInLoop的回调要唤醒loop 否则会等到下一个事件或者poll超时
+    bool callingIterationEndFunctors_;
 
 };
\ No newline at end of file
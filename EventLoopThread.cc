@@ -1,5 +1,6 @@
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "RingLogging.h"
 
 #include <memory>
 
@@ -52,6 +53,9 @@ EventLoop* EventLoopThread::startLoop()
 // 线程函数，该函数将在新线程中执行
 void EventLoopThread::threadFunc()  // 就是thread.cc中的func_
 {
+    // 开启了每线程日志环时 在进入事件循环之前创建本线程的日志环
+    RingLogging::instance().attachThread();
+
     EventLoop loop; // 创建一个独立的eventloop，和上面的线程是一一对应的，one loop per thread
 
     if (callback_)// 检查是否存在初始化回调函数
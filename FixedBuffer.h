@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string.h>
+#include <string>
+
+#include "noncopyable.h"
+
+const int kSmallBuffer = 4000;        // 单条日志使用的缓冲区大小
+const int kLargeBuffer = 4000 * 1000; // 异步日志前后端交换的缓冲区大小
+
+/*
+ * 固定大小的缓冲区 内存在对象中预先分配 append不会扩容
+ * 空间不足时直接丢弃超出的部分 日志系统不能因为一条日志阻塞或者分配内存
+ */
+template <int SIZE>
+class FixedBuffer : noncopyable
+{
+public:
+    FixedBuffer()
+        : cur_(data_)
+    {
+    }
+
+    void append(const char *buf, size_t len)
+    {
+        if (static_cast<size_t>(avail()) > len)
+        {
+            memcpy(cur_, buf, len);
+            cur_ += len;
+        }
+    }
+
+    const char *data() const { return data_; }
+    int length() const { return static_cast<int>(cur_ - data_); }
+
+    // 直接向缓冲区写数据时使用 写完后调用add移动写指针
+    char *current() { return cur_; }
+    int avail() const { return static_cast<int>(end() - cur_); }
+    void add(size_t len) { cur_ += len; }
+
+    void reset() { cur_ = data_; }
+    void bzero() { memset(data_, 0, sizeof data_); }
+
+    std::string toString() const { return std::string(data_, length()); }
+
+private:
+    const char *end() const { return data_ + sizeof data_; }
+
+    char data_[SIZE];
+    char *cur_;
+};
@@ -0,0 +1,144 @@
+#include "LogFile.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+LogFile::LogFile(const std::string &basename,
+                 off_t rollSize,
+                 int flushInterval,
+                 int checkEveryN)
+    : basename_(basename)
+    , rollSize_(rollSize)
+    , flushInterval_(flushInterval)
+    , checkEveryN_(checkEveryN)
+    , count_(0)
+    , startOfPeriod_(0)
+    , lastRoll_(0)
+    , lastFlush_(0)
+    , fp_(nullptr)
+    , writtenBytes_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *logline, size_t len)
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    // 只有后端线程写文件 使用unlocked版本避免stdio内部加锁
+    size_t written = 0;
+    while (written != len)
+    {
+        size_t n = ::fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if (n == 0)
+        {
+            int err = ferror(fp_);
+            if (err)
+            {
+                fprintf(stderr, "LogFile::append() failed %s\n", strerror(err));
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+
+    if (writtenBytes_ > rollSize_)
+    {
+        rollFile();
+    }
+    else if (++count_ >= checkEveryN_)
+    {
+        count_ = 0;
+        time_t now = ::time(NULL);
+        time_t thisPeriod = now / kRollPerSeconds_ * kRollPerSeconds_;
+        if (thisPeriod != startOfPeriod_) // 跨天了
+        {
+            rollFile();
+        }
+        else if (now - lastFlush_ > flushInterval_)
+        {
+            lastFlush_ = now;
+            flush();
+        }
+    }
+}
+
+void LogFile::flush()
+{
+    if (fp_)
+    {
+        ::fflush(fp_);
+    }
+}
+
+bool LogFile::rollFile()
+{
+    time_t now = 0;
+    std::string filename = getLogFileName(basename_, &now);
+    time_t start = now / kRollPerSeconds_ * kRollPerSeconds_;
+
+    // 同一秒内不重复滚动 否则文件名相同
+    if (now > lastRoll_)
+    {
+        lastRoll_ = now;
+        lastFlush_ = now;
+        startOfPeriod_ = start;
+        if (fp_)
+        {
+            ::fclose(fp_);
+        }
+        fp_ = ::fopen(filename.c_str(), "ae"); // e: O_CLOEXEC
+        if (fp_ == nullptr)
+        {
+            fprintf(stderr, "LogFile::rollFile() open %s failed: %s\n", filename.c_str(), strerror(errno));
+            return false;
+        }
+        ::setbuffer(fp_, buffer_, sizeof buffer_);
+        writtenBytes_ = 0;
+        return true;
+    }
+    return false;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t *now)
+{
+    std::string filename;
+    filename.reserve(basename.size() + 64);
+    filename = basename;
+
+    char timebuf[32];
+    struct tm tm;
+    *now = ::time(NULL);
+    ::localtime_r(now, &tm);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if (::gethostname(hostname, sizeof hostname) == 0)
+    {
+        filename += hostname;
+    }
+    else
+    {
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d", ::getpid());
+    filename += pidbuf;
+
+    filename += ".log";
+    return filename;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <memory>
+
+#include "noncopyable.h"
+
+/*
+ * 日志文件 按大小和天数滚动
+ * - 写入的字节数超过rollSize时滚动到新文件
+ * - 跨天时滚动到新文件
+ * - 每flushInterval秒刷新一次缓冲区
+ * 非线程安全 只由异步日志的后端线程使用
+ * 文件名格式：basename.20250101-120000.hostname.pid.log
+ */
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename,
+            off_t rollSize,
+            int flushInterval = 3,
+            int checkEveryN = 1024);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    // 滚动日志文件 返回是否创建了新文件
+    bool rollFile();
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t *now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int checkEveryN_; // 每写入checkEveryN次检查一次是否需要按时间滚动
+
+    int count_;
+    time_t startOfPeriod_; // 当前日志文件所属的一天的开始时刻
+    time_t lastRoll_;
+    time_t lastFlush_;
+
+    FILE *fp_;
+    off_t writtenBytes_; // 当前文件已经写入的字节数
+    char buffer_[64 * 1024]; // 文件的用户态缓冲区
+
+    static const int kRollPerSeconds_ = 60 * 60 * 24;
+};
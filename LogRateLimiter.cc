@@ -0,0 +1,58 @@
+#include "LogRateLimiter.h"
+#include "Timestamp.h"
+
+bool LogEveryN::allow(uint64_t *suppressed)
+{
+    if (count_.fetch_add(1, std::memory_order_relaxed) % n_ == 0)
+    {
+        *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool LogEveryMs::allow(uint64_t *suppressed)
+{
+    int64_t now = Timestamp::monotonicNow().microSecondsSinceEpoch();
+    int64_t last = last_.load(std::memory_order_relaxed);
+    // 多个线程同时到期时只有交换成功的那个输出
+    if ((last == 0 || now - last >= intervalMicros_)
+        && last_.compare_exchange_strong(last, now, std::memory_order_relaxed))
+    {
+        *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+LogTokenBucket::LogTokenBucket(double ratePerSecond, int burst)
+    : intervalMicros_(ratePerSecond > 0
+                      ? static_cast<int64_t>(Timestamp::kMicroSecondsPerSecond / ratePerSecond)
+                      : Timestamp::kMicroSecondsPerSecond)
+    , toleranceMicros_(intervalMicros_ * (burst > 1 ? burst - 1 : 0))
+    , tat_(0)
+    , suppressed_(0)
+{
+}
+
+bool LogTokenBucket::allow(uint64_t *suppressed)
+{
+    int64_t now = Timestamp::monotonicNow().microSecondsSinceEpoch();
+    int64_t tat = tat_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        int64_t start = tat > now ? tat : now;
+        if (start - now > toleranceMicros_) // 桶里没有令牌了
+        {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (tat_.compare_exchange_weak(tat, start + intervalMicros_, std::memory_order_relaxed))
+        {
+            *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "noncopyable.h"
+
+/*
+ * 热路径日志的限流 每个LOG_XXX_EVERY_N/EVERY_MS/RATE_LIMITED调用点持有一个静态的限流器
+ * - allow返回true表示这一次需要输出 同时通过suppressed返回上次输出之后被压制的条数
+ * - 被压制的调用只做一次原子操作 不格式化也不取时间(EVERY_N)
+ * - 多个线程共享同一个调用点的限流器 不加锁
+ */
+
+// 每N次输出一次 第1、N+1、2N+1...次输出
+class LogEveryN : noncopyable
+{
+public:
+    explicit LogEveryN(int n)
+        : n_(n > 0 ? n : 1)
+        , count_(0)
+        , suppressed_(0)
+    {
+    }
+
+    bool allow(uint64_t *suppressed);
+
+private:
+    const uint64_t n_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> suppressed_;
+};
+
+// 每隔intervalMs毫秒最多输出一次
+class LogEveryMs : noncopyable
+{
+public:
+    explicit LogEveryMs(int intervalMs)
+        : intervalMicros_(static_cast<int64_t>(intervalMs) * 1000)
+        , last_(0)
+        , suppressed_(0)
+    {
+    }
+
+    bool allow(uint64_t *suppressed);
+
+private:
+    const int64_t intervalMicros_;
+    std::atomic<int64_t> last_; // 上一次输出的单调时间 0表示还没有输出过
+    std::atomic<uint64_t> suppressed_;
+};
+
+/*
+ * 令牌桶：平均每秒最多输出ratePerSecond条 允许突发burst条
+ * 用GCRA的方式实现 只需要维护一个"理论到达时间"的原子变量 不需要定时补充令牌
+ */
+class LogTokenBucket : noncopyable
+{
+public:
+    LogTokenBucket(double ratePerSecond, int burst);
+
+    bool allow(uint64_t *suppressed);
+
+private:
+    const int64_t intervalMicros_;  // 每个令牌的间隔
+    const int64_t toleranceMicros_; // 允许提前的时间 (burst-1)*interval
+    std::atomic<int64_t> tat_;      // 理论到达时间
+    std::atomic<uint64_t> suppressed_;
+};
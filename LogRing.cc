@@ -0,0 +1,88 @@
+#include "LogRing.h"
+
+#include <string.h>
+
+static size_t roundUpPowerOfTwo(size_t n)
+{
+    size_t size = 1;
+    while (size < n)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+LogRing::LogRing(size_t capacity)
+    : buffer_(roundUpPowerOfTwo(capacity))
+    , mask_(buffer_.size() - 1)
+    , head_(0)
+    , tail_(0)
+    , dropped_(0)
+    , closed_(false)
+{
+}
+
+bool LogRing::push(const char *data, uint32_t len)
+{
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t need = sizeof len + len;
+    if (buffer_.size() - (head - tail) < need)
+    {
+        return false;
+    }
+    copyIn(head, reinterpret_cast<const char*>(&len), sizeof len);
+    copyIn(head + sizeof len, data, len);
+    // release保证消费者看到新的head_时 记录内容已经写完
+    head_.store(head + need, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::front(std::vector<char> *record) const
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    uint32_t len = 0;
+    copyOut(tail, reinterpret_cast<char*>(&len), sizeof len);
+    record->resize(len);
+    if (len > 0)
+    {
+        copyOut(tail + sizeof len, &*record->begin(), len);
+    }
+    return true;
+}
+
+void LogRing::pop()
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t len = 0;
+    copyOut(tail, reinterpret_cast<char*>(&len), sizeof len);
+    // release保证生产者看到新的tail_时 这段空间已经读完
+    tail_.store(tail + sizeof len + len, std::memory_order_release);
+}
+
+void LogRing::copyIn(size_t pos, const char *data, size_t len)
+{
+    size_t idx = pos & mask_;
+    size_t first = len < buffer_.size() - idx ? len : buffer_.size() - idx;
+    ::memcpy(&buffer_[idx], data, first);
+    if (first < len) // 跨越了环的末尾
+    {
+        ::memcpy(&buffer_[0], data + first, len - first);
+    }
+}
+
+void LogRing::copyOut(size_t pos, char *data, size_t len) const
+{
+    size_t idx = pos & mask_;
+    size_t first = len < buffer_.size() - idx ? len : buffer_.size() - idx;
+    ::memcpy(data, &buffer_[idx], first);
+    if (first < len)
+    {
+        ::memcpy(data + first, &buffer_[0], len - first);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "noncopyable.h"
+
+/*
+ * 单生产者单消费者(SPSC)的无锁环形字节缓冲区 用于每个线程的日志记录
+ * - 生产者是写日志的线程 只修改head_
+ * - 消费者是日志后端线程 只修改tail_
+ * 每条记录的格式为 [uint32 长度][数据] 记录可以跨越环的末尾
+ * head_和tail_只增不减 用 & mask_ 得到实际下标
+ */
+class LogRing : noncopyable
+{
+public:
+    // capacity向上取整为2的幂
+    explicit LogRing(size_t capacity);
+
+    // 生产者：写入一条记录 空间不足返回false
+    bool push(const char *data, uint32_t len);
+
+    // 消费者：拷贝队首记录但不移除 没有记录返回false
+    bool front(std::vector<char> *record) const;
+    // 消费者：移除队首记录
+    void pop();
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return buffer_.size(); }
+
+    // 因为空间不足被丢弃的记录数
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    void addDropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+    // 生产者线程退出时关闭 后端取完剩余记录后释放
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    void copyIn(size_t pos, const char *data, size_t len);
+    void copyOut(size_t pos, char *data, size_t len) const;
+
+    std::vector<char> buffer_;
+    const size_t mask_;
+
+    // 生产者和消费者各自修改的下标用填充隔开 放在不同的缓存行 避免伪共享
+    char pad0_[64];
+    std::atomic<size_t> head_; // 下一个写入位置
+    char pad1_[64];
+    std::atomic<size_t> tail_; // 下一个读取位置
+    char pad2_[64];
+    std::atomic<uint64_t> dropped_;
+    std::atomic_bool closed_;
+};
+
+// 线程持有的LogRing 作为thread_local变量使用
+// 线程退出时关闭LogRing 由后端线程取完剩余记录后释放
+struct LogRingHolder
+{
+    LogRingHolder() : ring(nullptr) {}
+    ~LogRingHolder()
+    {
+        if (ring)
+        {
+            ring->close();
+        }
+    }
+    LogRing *ring;
+};
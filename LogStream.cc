@@ -0,0 +1,173 @@
+#include "LogStream.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <type_traits>
+
+namespace
+{
+    // 余数可能为负 用对称的表取数字 不需要先取绝对值(INT64_MIN取绝对值会溢出)
+    const char digits[] = "9876543210123456789";
+    const char *zero = digits + 9;
+
+    const char digitsHex[] = "0123456789abcdef";
+}
+
+size_t convertDecimal(char buf[], int64_t value)
+{
+    int64_t i = value;
+    char *p = buf;
+
+    do
+    {
+        int lsd = static_cast<int>(i % 10);
+        i /= 10;
+        *p++ = zero[lsd];
+    } while (i != 0);
+
+    if (value < 0)
+    {
+        *p++ = '-';
+    }
+    *p = '\0';
+    std::reverse(buf, p);
+
+    return p - buf;
+}
+
+size_t convertUnsigned(char buf[], uint64_t value)
+{
+    uint64_t i = value;
+    char *p = buf;
+
+    do
+    {
+        int lsd = static_cast<int>(i % 10);
+        i /= 10;
+        *p++ = zero[lsd];
+    } while (i != 0);
+
+    *p = '\0';
+    std::reverse(buf, p);
+
+    return p - buf;
+}
+
+size_t convertHex(char buf[], uintptr_t value)
+{
+    uintptr_t i = value;
+    char *p = buf;
+
+    do
+    {
+        int lsd = static_cast<int>(i % 16);
+        i /= 16;
+        *p++ = digitsHex[lsd];
+    } while (i != 0);
+
+    *p = '\0';
+    std::reverse(buf, p);
+
+    return p - buf;
+}
+
+template <typename T>
+void LogStream::formatInteger(T v)
+{
+    // 剩余空间不够时整个数字都不写 不输出被截断的数字
+    if (buffer_.avail() >= kMaxNumericSize)
+    {
+        size_t len = std::is_signed<T>::value
+                   ? convertDecimal(buffer_.current(), static_cast<int64_t>(v))
+                   : convertUnsigned(buffer_.current(), static_cast<uint64_t>(v));
+        buffer_.add(len);
+    }
+}
+
+LogStream& LogStream::operator<<(short v)
+{
+    *this << static_cast<int>(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned short v)
+{
+    *this << static_cast<unsigned int>(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(int v)
+{
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned int v)
+{
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(long v)
+{
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned long v)
+{
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(long long v)
+{
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned long long v)
+{
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(const void *p)
+{
+    uintptr_t v = reinterpret_cast<uintptr_t>(p);
+    if (buffer_.avail() >= kMaxNumericSize)
+    {
+        char *buf = buffer_.current();
+        buf[0] = '0';
+        buf[1] = 'x';
+        size_t len = convertHex(buf + 2, v);
+        buffer_.add(len + 2);
+    }
+    return *this;
+}
+
+// 浮点数的转换比较复杂 仍然使用snprintf
+LogStream& LogStream::operator<<(double v)
+{
+    if (buffer_.avail() >= kMaxNumericSize)
+    {
+        int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
+        buffer_.add(len);
+    }
+    return *this;
+}
+
+LogStream& operator<<(LogStream &s, Hex h)
+{
+    char buf[32];
+    size_t len = convertHex(buf, static_cast<uintptr_t>(h.value()));
+    s.append("0x", 2);
+    s.append(buf, len);
+    return s;
+}
+
+LogLine::~LogLine()
+{
+    const LogStream::Buffer &buf = stream_.buffer();
+    Logger::instance().log(level_, buf.data(), buf.length());
+}
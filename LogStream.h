@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <string.h>
+
+#include "noncopyable.h"
+#include "FixedBuffer.h"
+#include "StringPiece.h"
+#include "Logger.h"
+
+/*
+ * 流式日志 LOG_STREAM_INFO << "fd=" << fd << " conn=" << conn.get();
+ * - 内容直接写入对象内部固定大小的缓冲区(kSmallBuffer) 每行日志没有任何堆内存分配
+ * - 整数、十六进制、指针使用手写的转换 不经过snprintf的格式串解析
+ * - 过滤规则和printf风格的LOG_XXX相同：编译期低于MUDUO_MIN_LOG_LEVEL的语句整体变成死代码，
+ *   运行期低于Logger::logLevel()的语句不会执行任何<<
+ */
+class LogStream : noncopyable
+{
+public:
+    using Buffer = FixedBuffer<kSmallBuffer>;
+
+    LogStream& operator<<(bool v)
+    {
+        buffer_.append(v ? "1" : "0", 1);
+        return *this;
+    }
+
+    LogStream& operator<<(short);
+    LogStream& operator<<(unsigned short);
+    LogStream& operator<<(int);
+    LogStream& operator<<(unsigned int);
+    LogStream& operator<<(long);
+    LogStream& operator<<(unsigned long);
+    LogStream& operator<<(long long);
+    LogStream& operator<<(unsigned long long);
+
+    // 指针按0x开头的十六进制输出
+    LogStream& operator<<(const void *);
+
+    LogStream& operator<<(float v)
+    {
+        *this << static_cast<double>(v);
+        return *this;
+    }
+    LogStream& operator<<(double);
+
+    LogStream& operator<<(char v)
+    {
+        buffer_.append(&v, 1);
+        return *this;
+    }
+
+    LogStream& operator<<(const char *str)
+    {
+        if (str)
+        {
+            buffer_.append(str, ::strlen(str));
+        }
+        else
+        {
+            buffer_.append("(null)", 6);
+        }
+        return *this;
+    }
+
+    LogStream& operator<<(const unsigned char *str)
+    {
+        return operator<<(reinterpret_cast<const char*>(str));
+    }
+
+    LogStream& operator<<(const std::string &v)
+    {
+        buffer_.append(v.data(), v.size());
+        return *this;
+    }
+
+    LogStream& operator<<(const StringPiece &v)
+    {
+        buffer_.append(v.data(), v.size());
+        return *this;
+    }
+
+    void append(const char *data, size_t len) { buffer_.append(data, len); }
+    const Buffer& buffer() const { return buffer_; }
+    void resetBuffer() { buffer_.reset(); }
+
+private:
+    template <typename T>
+    void formatInteger(T);
+
+    Buffer buffer_;
+
+    static const int kMaxNumericSize = 48;
+};
+
+// 按十六进制输出整数 LOG_STREAM_INFO << Hex(flags);
+class Hex
+{
+public:
+    explicit Hex(uint64_t value) : value_(value) {}
+    uint64_t value() const { return value_; }
+private:
+    uint64_t value_;
+};
+
+LogStream& operator<<(LogStream &s, Hex h);
+
+// 手写的整数转换 返回写入的长度 buf至少需要32字节
+size_t convertDecimal(char buf[], int64_t value);
+size_t convertUnsigned(char buf[], uint64_t value);
+size_t convertHex(char buf[], uintptr_t value);
+
+/*
+ * 一行流式日志 析构时把缓冲区中的内容交给Logger
+ * 只在通过了级别过滤之后才会构造
+ */
+class LogLine : noncopyable
+{
+public:
+    explicit LogLine(int level) : level_(level) {}
+    ~LogLine();
+
+    LogStream& stream() { return stream_; }
+
+private:
+    int level_;
+    LogStream stream_;
+};
+
+// 未通过过滤时 if分支为空语句 <<右侧的表达式不会被求值
+#define MUDUO_LOG_STREAM_IMPL(level) \
+    if (!Logger::isEnabled(level)) \
+        ; \
+    else \
+        LogLine(level).stream()
+
+// 编译期被去掉的级别 条件恒为真 else分支成为死代码由编译器删除
+#define MUDUO_LOG_STREAM_DISABLED(level) \
+    if (true) \
+        ; \
+    else \
+        LogLine(level).stream()
+
+#if MUDUO_MIN_LOG_LEVEL <= 0
+#define LOG_STREAM_DEBUG MUDUO_LOG_STREAM_IMPL(DEBUG)
+#else
+#define LOG_STREAM_DEBUG MUDUO_LOG_STREAM_DISABLED(DEBUG)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_STREAM_INFO MUDUO_LOG_STREAM_IMPL(INFO)
+#else
+#define LOG_STREAM_INFO MUDUO_LOG_STREAM_DISABLED(INFO)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_STREAM_ERROR MUDUO_LOG_STREAM_IMPL(ERROR)
+#else
+#define LOG_STREAM_ERROR MUDUO_LOG_STREAM_DISABLED(ERROR)
+#endif
@@ -1,8 +1,57 @@
 
 #include"Logger.h"
 
-#include<iostream>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include "Timestamp.h"
+#include "RingLogging.h"
+
+namespace
+{
+    // 每个线程缓存最近一次格式化的秒 同一秒内的日志不再调用localtime_r和snprintf
+    thread_local time_t t_lastSecond = -1;
+    thread_local char t_secondStr[32];
+    thread_local int t_secondLen = 0;
+
+    // 格式与Timestamp::toString相同 如 2025/01/01 12:00:00
+    const char* formatSeconds(Timestamp time, int *len)
+    {
+        time_t seconds = static_cast<time_t>(time.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond);
+        if (seconds != t_lastSecond)
+        {
+            struct tm tm_time;
+            ::localtime_r(&seconds, &tm_time);
+            int n = snprintf(t_secondStr, sizeof t_secondStr, "%4d/%02d/%02d %02d:%02d:%02d",
+                             tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                             tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+            t_secondLen = Logger::truncatedLength(n, sizeof t_secondStr);
+            t_lastSecond = seconds;
+        }
+        *len = t_secondLen;
+        return t_secondStr;
+    }
+}
+
+// 默认输出到stdout 不再每条日志都flush
+static void defaultOutput(const char *msg, int len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush()
+{
+    ::fflush(stdout);
+}
+
+// 运行期阈值默认与编译期最低级别一致 定义了MUDEBUG时默认输出DEBUG日志
+std::atomic_int Logger::s_logLevel_(MUDUO_MIN_LOG_LEVEL);
+
+Logger::Logger()
+    : output_(defaultOutput)
+    , flush_(defaultFlush)
+{
+}
 
 // 获取日志唯一的实例对象
 Logger& Logger::instance()
@@ -10,33 +59,67 @@ Logger& Logger::instance()
     static Logger logger;
     return logger;
 }
-// 设置日志级别
-void Logger::setLogLevel(int level)
+// 写日志 [级别信息] time : msg
+// 整行在栈上拼接好后交给output_一次写出 不在IO线程上做同步flush
+void Logger::log(int level, const char *msg, int msgLen)
 {
-    logLevel_ = level;
+    log(level, Timestamp::now(), msg, msgLen);
 }
-// 写日志 [级别信息] time : msg
-void Logger::log(std::string msg)
+
+void Logger::log(int level, Timestamp time, const char *msg, int msgLen)
+{
+    char line[kMaxLineLen];
+    int len = formatLine(line, sizeof line, level, time, msg, msgLen);
+    // 开启了每线程日志环时只写入本线程的环 FATAL之后进程马上退出 直接输出
+    if (RingLogging::enabled() && level != FATAL)
+    {
+        RingLogging::instance().append(level, time, line, len);
+        return;
+    }
+    output_(line, len);
+
+    if (level == FATAL)
+    {
+        flush_(); // 进程马上退出 保证这条日志落盘
+    }
+}
+
+int Logger::formatLine(char *line, size_t size, int level, Timestamp time, const char *msg, int msgLen)
 {
-    std::string pre = "";
-    switch (logLevel_)
+    const char *pre = "";
+    switch (level)
     {
     case INFO:
-        std::cout << "[INFO]";
+        pre = "[INFO]";
         break;
     case ERROR:
-        std::cout << "[ERROR]";
+        pre = "[ERROR]";
         break;
     case FATAL:
-        std::cout << "[FATAL]";
+        pre = "[FATAL]";
         break;
     case DEBUG:
-        std::cout << "[DEBUG]";
+        pre = "[DEBUG]";
         break;
     default:
         break;
     }
 
-    // 打印时间和msg
-    std::cout << pre + Timestamp::now().toString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+    // 打印时间和msg 时间在栈上拼接 不构造std::string
+    int secondLen = 0;
+    const char *seconds = formatSeconds(time, &secondLen);
+    int len = snprintf(line, size, "%s%.*s : ", pre, secondLen, seconds);
+    len = truncatedLength(len, size);
+    if (msgLen > static_cast<int>(size) - len - 1)
+    {
+        msgLen = static_cast<int>(size) - len - 1; // 过长的日志截断
+    }
+    ::memcpy(line + len, msg, msgLen);
+    len += msgLen;
+    // 大部分调用处的格式串已经以换行结尾 没有的补一个
+    if (msgLen == 0 || line[len - 1] != '\n')
+    {
+        line[len++] = '\n';
+    }
+    return len;
+}
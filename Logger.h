@@ -1,81 +1,213 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "noncopyable.h"
+#include "Timestamp.h"
+#include "FixedBuffer.h"
+#include "BinaryLog.h"
+#include "LogRateLimiter.h"
 
-// 定义四种宏 定义宏且需要分行的时候，末尾要加反斜杠
-#define LOG_INFO(logmsgFormat, ...) \
+/*
+ * 日志级别的过滤分为两层
+ * - 编译期：MUDUO_MIN_LOG_LEVEL 低于该级别的LOG_XXX在预处理阶段就展开为空语句，参数也不会被求值
+ *   0-DEBUG 1-INFO 2-ERROR 3-FATAL 可以通过 -DMUDUO_MIN_LOG_LEVEL=2 指定
+ *   未指定时 定义了MUDEBUG则为DEBUG 否则为INFO
+ * - 运行期：Logger::setLogLevel设置的阈值 在格式化之前检查 被过滤的日志不会执行snprintf
+ * 每条日志的级别作为参数传给Logger::log 多个线程同时写日志不会互相影响级别
+ * 开启二进制日志模式(BinaryLog::start)后 通过过滤的日志不再格式化 只记录原始参数
+ */
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL 0
+#else
+#define MUDUO_MIN_LOG_LEVEL 1
+#endif
+#endif
+
+// 定义宏且需要分行的时候，末尾要加反斜杠
+#define MUDUO_LOG_IMPL(level, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if (Logger::isEnabled(level)) \
+        { \
+            if (BinaryLog::enabled()) \
+            { \
+                static const int muduoFormatId = \
+                    BinaryLog::instance().registerFormat(level, __FILE__, __LINE__, logmsgFormat); \
+                BinaryLog::instance().write(muduoFormatId, ##__VA_ARGS__); \
+            } \
+            else \
+            { \
+                char buf[1024]; \
+                int len = snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__); \
+                Logger::instance().log(level, buf, Logger::truncatedLength(len, sizeof buf)); \
+            } \
+        } \
     } while(0)
 
-#define LOG_ERROR(logmsgFormat, ...) \
+#if MUDUO_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(logmsgFormat, ...) do {} while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...) do {} while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...) do {} while(0)
+#endif
+
+/*
+ * 限流的日志 用于出错时可能被频繁触发的路径
+ * LOG_XXX_EVERY_N(n, ...)              每n次输出一次
+ * LOG_XXX_EVERY_MS(ms, ...)            每ms毫秒最多输出一次
+ * LOG_XXX_RATE_LIMITED(rate, burst, ...) 令牌桶 每秒最多rate条 允许突发burst条
+ * 限流器是调用点的静态变量 输出时如果之前有被压制的日志 先输出一条压制的条数
+ */
+#define MUDUO_LOG_LIMITED_IMPL(level, limiterType, limiterArgs, logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if (Logger::isEnabled(level)) \
+        { \
+            static limiterType muduoLimiter limiterArgs; \
+            uint64_t muduoSuppressed = 0; \
+            if (muduoLimiter.allow(&muduoSuppressed)) \
+            { \
+                if (muduoSuppressed > 0) \
+                { \
+                    MUDUO_LOG_IMPL(level, "%s:%d suppressed %llu log lines\n", __FILE__, __LINE__, \
+                                   static_cast<unsigned long long>(muduoSuppressed)); \
+                } \
+                MUDUO_LOG_IMPL(level, logmsgFormat, ##__VA_ARGS__); \
+            } \
+        } \
     } while(0)
 
+#define MUDUO_LOG_EVERY_N(level, n, logmsgFormat, ...) \
+    MUDUO_LOG_LIMITED_IMPL(level, LogEveryN, (n), logmsgFormat, ##__VA_ARGS__)
+#define MUDUO_LOG_EVERY_MS(level, ms, logmsgFormat, ...) \
+    MUDUO_LOG_LIMITED_IMPL(level, LogEveryMs, (ms), logmsgFormat, ##__VA_ARGS__)
+#define MUDUO_LOG_RATE_LIMITED(level, rate, burst, logmsgFormat, ...) \
+    MUDUO_LOG_LIMITED_IMPL(level, LogTokenBucket, (rate, burst), logmsgFormat, ##__VA_ARGS__)
+
+#if MUDUO_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG_EVERY_N(n, logmsgFormat, ...) MUDUO_LOG_EVERY_N(DEBUG, n, logmsgFormat, ##__VA_ARGS__)
+#define LOG_DEBUG_EVERY_MS(ms, logmsgFormat, ...) MUDUO_LOG_EVERY_MS(DEBUG, ms, logmsgFormat, ##__VA_ARGS__)
+#define LOG_DEBUG_RATE_LIMITED(rate, burst, logmsgFormat, ...) \
+    MUDUO_LOG_RATE_LIMITED(DEBUG, rate, burst, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG_EVERY_N(n, logmsgFormat, ...) do {} while(0)
+#define LOG_DEBUG_EVERY_MS(ms, logmsgFormat, ...) do {} while(0)
+#define LOG_DEBUG_RATE_LIMITED(rate, burst, logmsgFormat, ...) do {} while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_INFO_EVERY_N(n, logmsgFormat, ...) MUDUO_LOG_EVERY_N(INFO, n, logmsgFormat, ##__VA_ARGS__)
+#define LOG_INFO_EVERY_MS(ms, logmsgFormat, ...) MUDUO_LOG_EVERY_MS(INFO, ms, logmsgFormat, ##__VA_ARGS__)
+#define LOG_INFO_RATE_LIMITED(rate, burst, logmsgFormat, ...) \
+    MUDUO_LOG_RATE_LIMITED(INFO, rate, burst, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO_EVERY_N(n, logmsgFormat, ...) do {} while(0)
+#define LOG_INFO_EVERY_MS(ms, logmsgFormat, ...) do {} while(0)
+#define LOG_INFO_RATE_LIMITED(rate, burst, logmsgFormat, ...) do {} while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_ERROR_EVERY_N(n, logmsgFormat, ...) MUDUO_LOG_EVERY_N(ERROR, n, logmsgFormat, ##__VA_ARGS__)
+#define LOG_ERROR_EVERY_MS(ms, logmsgFormat, ...) MUDUO_LOG_EVERY_MS(ERROR, ms, logmsgFormat, ##__VA_ARGS__)
+#define LOG_ERROR_RATE_LIMITED(rate, burst, logmsgFormat, ...) \
+    MUDUO_LOG_RATE_LIMITED(ERROR, rate, burst, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR_EVERY_N(n, logmsgFormat, ...) do {} while(0)
+#define LOG_ERROR_EVERY_MS(ms, logmsgFormat, ...) do {} while(0)
+#define LOG_ERROR_RATE_LIMITED(rate, burst, logmsgFormat, ...) do {} while(0)
+#endif
+
+// FATAL不受任何过滤 输出后退出进程
 #define LOG_FATAL(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        char buf[1024]; \
+        int len = snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__); \
+        Logger::instance().log(FATAL, buf, Logger::truncatedLength(len, sizeof buf)); \
         exit(-1); \
     } while(0)
 
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...) \
-    do \
-    { \
-        Logger &logger = Logger::instance(); \
-        logger.setLoglevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0)
-#else
-    #define LOG_DEBUG(logmsgFormat, ...)
-#endif
-
-/* 定义日志的级别 
+/* 定义日志的级别 数值越大越严重
+ * DEBUG -调试信息，正常运行时可以关掉
  * INFO  -记录
  * ERROR -不影响运行的报错信息
  * FATAL -毁灭性打击的报错
- * DEBUG -调试信息，正常运行时可以关掉
  */
 
 enum LogLevel
 {
+    DEBUG,
     INFO,
     ERROR,
     FATAL,
-    DEBUG,
 };
 
 // 输出一个日志类
 class Logger : noncopyable
 {
 public:
+    // 日志的输出目的地 默认输出到stdout 可以替换为AsyncLogging::append
+    using OutputFunc = void (*)(const char *msg, int len);
+    using FlushFunc = void (*)();
+
+    // 日志行前缀 [级别]time : 的最大长度
+    static const int kMaxPrefixLen = 64;
+    // 一行日志的最大长度 LOG_STREAM_XXX的一行最长kSmallBuffer 加上前缀也不会被截断
+    // 日志环中的记录按这个长度预留
+    static const int kMaxLineLen = kSmallBuffer + kMaxPrefixLen;
+
     // 获取日志唯一的实例对象
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int level);
-    // 写日志
-    void log(std::string msg);
+
+    // 设置运行期的日志级别阈值 低于该级别的日志不输出 线程安全
+    static void setLogLevel(int level) { s_logLevel_.store(level, std::memory_order_relaxed); }
+    static int logLevel() { return s_logLevel_.load(std::memory_order_relaxed); }
+    // 该级别的日志是否需要输出 在格式化之前调用
+    static bool isEnabled(int level) { return level >= logLevel(); }
+
+    // 写日志 msg是已经格式化好的内容 len为实际长度
+    void log(int level, const char *msg, int len);
+    // 指定日志时间 二进制日志在后台解码时使用记录中的时间
+    void log(int level, Timestamp time, const char *msg, int len);
+
+    // 拼接一行完整的日志 [级别]time : msg\n 返回长度
+    static int formatLine(char *line, size_t size, int level, Timestamp time, const char *msg, int msgLen);
+
+    // snprintf的返回值可能超过缓冲区大小(内容被截断) 换算为实际写入的长度
+    static int truncatedLength(int len, size_t bufSize)
+    {
+        if (len < 0)
+        {
+            return 0;
+        }
+        return static_cast<size_t>(len) < bufSize ? len : static_cast<int>(bufSize - 1);
+    }
+
+    // 把完整的一行日志交给输出函数 日志后端线程使用
+    void output(const char *line, int len) { output_(line, len); }
+
+    // 设置日志的输出函数和刷新函数
+    void setOutput(OutputFunc out) { output_ = out; }
+    void setFlush(FlushFunc flush) { flush_ = flush; }
 private:
-    int logLevel_;
-    Logger(){}
-};
\ No newline at end of file
+    static std::atomic_int s_logLevel_;
+    OutputFunc output_;
+    FlushFunc flush_;
+    Logger();
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "noncopyable.h"
+#include "StringPiece.h"
+
+/*
+ * 不可变的共享数据 用于把同一份数据发给很多连接(广播、行情推送)
+ * TcpConnection::send(PayloadPtr)只把引用放进输出队列 writev直接从这块内存读
+ * 所有连接发完之后随着最后一个引用释放
+ * 创建之后内容不能再修改 所以可以被多个loop线程同时读取
+ */
+class Payload : noncopyable
+{
+public:
+    explicit Payload(std::string &&data)
+        : data_(std::move(data))
+    {
+    }
+    Payload(const void *data, size_t len)
+        : data_(static_cast<const char*>(data), len)
+    {
+    }
+
+    const char *data() const { return data_.data(); }
+    size_t size() const { return data_.size(); }
+    StringPiece toStringPiece() const { return StringPiece(data_); }
+
+private:
+    const std::string data_;
+};
+
+using PayloadPtr = std::shared_ptr<const Payload>;
+
+// 接管字符串的内容 不拷贝
+inline PayloadPtr makePayload(std::string &&data)
+{
+    return std::make_shared<const Payload>(std::move(data));
+}
+
+inline PayloadPtr makePayload(const void *data, size_t len)
+{
+    return std::make_shared<const Payload>(data, len);
+}
+
+/*
+ * TcpConnection::sendv的一个片段 例如 头部+正文+尾部 分别来自不同的内存
+ * 普通片段只是调用者内存的视图 写不完的部分需要拷贝进输出队列
+ * 由PayloadPtr构造的片段持有引用 写不完的部分只在输出队列中记录引用
+ */
+struct SendSlice
+{
+    SendSlice(const void *d, size_t len)
+        : data(static_cast<const char*>(d))
+        , size(len)
+    {
+    }
+    SendSlice(const StringPiece &piece)
+        : data(piece.data())
+        , size(piece.size())
+    {
+    }
+    SendSlice(const std::string &str)
+        : data(str.data())
+        , size(str.size())
+    {
+    }
+    SendSlice(const char *str)
+        : SendSlice(StringPiece(str))
+    {
+    }
+    SendSlice(const PayloadPtr &p)
+        : data(p ? p->data() : nullptr)
+        , size(p ? p->size() : 0)
+        , payload(p)
+    {
+    }
+
+    const char *data;
+    size_t size;
+    PayloadPtr payload;
+};
@@ -0,0 +1,288 @@
+#include "RingLogging.h"
+#include "LogRing.h"
+#include "Logger.h"
+#include "Thread.h"
+
+#include <sched.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+std::atomic_bool RingLogging::s_enabled_(false);
+
+namespace
+{
+    // 每个线程持有自己的文本日志环 与BinaryLog的环相互独立(记录格式和后端线程都不同)
+    // 同一线程两者都用时会有两个环 这里只复用LogRingHolder类型
+    thread_local LogRingHolder t_textRingHolder;
+
+    const size_t kDefaultRingSize = 256 * 1024;
+    // 环至少要能放下几条最长的记录 否则kBlock策略下一条长日志会永远等待
+    const size_t kMinRingSize = 16 * 1024;
+
+    // 记录头：int64 时间戳(微秒) + int32 级别 后面是格式化好的一行日志
+    const size_t kRecordHeaderSize = sizeof(int64_t) + sizeof(int32_t);
+
+    int64_t recordTime(const std::vector<char> &record)
+    {
+        int64_t time = 0;
+        ::memcpy(&time, &record[0], sizeof time);
+        return time;
+    }
+}
+
+RingLogging& RingLogging::instance()
+{
+    // 故意不析构 其它线程在进程退出时可能还在写日志
+    static RingLogging *ringLogging = new RingLogging;
+    return *ringLogging;
+}
+
+RingLogging::RingLogging()
+    : ringSize_(kDefaultRingSize)
+    , running_(false)
+{
+    // 默认：调试和普通日志丢弃并计数 错误日志宁可等待也不丢
+    policies_[DEBUG] = kCountDrop;
+    policies_[INFO] = kCountDrop;
+    policies_[ERROR] = kBlock;
+    policies_[FATAL] = kBlock;
+    for (int i = 0; i < kNumLevels; ++i)
+    {
+        dropped_[i] = 0;
+        reported_[i] = 0;
+    }
+}
+
+RingLogging::~RingLogging()
+{
+}
+
+void RingLogging::setOverflowPolicy(int level, OverflowPolicy policy)
+{
+    if (level >= 0 && level < kNumLevels)
+    {
+        policies_[level] = policy;
+    }
+}
+
+void RingLogging::start()
+{
+    if (running_)
+    {
+        return;
+    }
+    running_ = true;
+    thread_.reset(new Thread(std::bind(&RingLogging::threadFunc, this), "RingLogging"));
+    thread_->start();
+    s_enabled_ = true;
+}
+
+void RingLogging::stop()
+{
+    if (!running_)
+    {
+        return;
+    }
+    s_enabled_ = false;
+    running_ = false;
+    cond_.notify_one();
+    thread_->join();
+    thread_.reset();
+}
+
+void RingLogging::attachThread()
+{
+    if (enabled())
+    {
+        threadRing();
+    }
+}
+
+LogRing* RingLogging::threadRing()
+{
+    if (__builtin_expect(t_textRingHolder.ring == nullptr, 0))
+    {
+        t_textRingHolder.ring = new LogRing(std::max(ringSize_, kMinRingSize));
+        std::unique_lock<std::mutex> lock(ringsMutex_);
+        rings_.push_back(t_textRingHolder.ring);
+    }
+    return t_textRingHolder.ring;
+}
+
+void RingLogging::append(int level, Timestamp time, const char *line, int len)
+{
+    // 与Logger::log的行缓冲区一样大 正常情况下不会截断
+    char record[kRecordHeaderSize + Logger::kMaxLineLen];
+    bool truncated = false;
+    if (len > Logger::kMaxLineLen)
+    {
+        len = Logger::kMaxLineLen;
+        truncated = true;
+    }
+    int64_t micros = time.microSecondsSinceEpoch();
+    int32_t lv = level;
+    ::memcpy(record, &micros, sizeof micros);
+    ::memcpy(record + sizeof micros, &lv, sizeof lv);
+    ::memcpy(record + kRecordHeaderSize, line, len);
+    if (truncated)
+    {
+        record[kRecordHeaderSize + len - 1] = '\n'; // 截断的行仍然以换行结束 不和下一条连在一起
+    }
+    uint32_t recordLen = static_cast<uint32_t>(kRecordHeaderSize + len);
+
+    LogRing *ring = threadRing();
+    if (ring->push(record, recordLen))
+    {
+        return;
+    }
+
+    // 环满了 按照该级别的策略处理
+    OverflowPolicy policy = (level >= 0 && level < kNumLevels) ? policies_[level] : kCountDrop;
+    switch (policy)
+    {
+    case kBlock:
+        while (!ring->push(record, recordLen))
+        {
+            if (!running_) // 后端已经停止 不能再等了 直接输出
+            {
+                Logger::instance().output(record + kRecordHeaderSize, len);
+                return;
+            }
+            cond_.notify_one(); // 催促后端尽快取走记录
+            ::sched_yield();
+        }
+        break;
+    case kDiscard:
+        break;
+    case kCountDrop:
+        dropped_[level].fetch_add(1, std::memory_order_relaxed);
+        ring->addDropped();
+        break;
+    }
+}
+
+uint64_t RingLogging::droppedCount(int level) const
+{
+    if (level < 0 || level >= kNumLevels)
+    {
+        return 0;
+    }
+    return dropped_[level].load(std::memory_order_relaxed);
+}
+
+uint64_t RingLogging::droppedCount() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < kNumLevels; ++i)
+    {
+        total += dropped_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void RingLogging::threadFunc()
+{
+    while (running_)
+    {
+        if (!drain())
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        reportDropped();
+    }
+    drain(); // 退出前取完剩余的记录
+    reportDropped();
+}
+
+bool RingLogging::drain()
+{
+    std::vector<LogRing*> rings;
+    {
+        std::unique_lock<std::mutex> lock(ringsMutex_);
+        rings = rings_;
+    }
+
+    // 每个环的队首记录
+    struct Head
+    {
+        std::vector<char> record;
+        bool valid;
+    };
+    std::vector<Head> heads(rings.size());
+    for (size_t i = 0; i < rings.size(); ++i)
+    {
+        heads[i].valid = rings[i]->front(&heads[i].record);
+    }
+
+    // 多路归并 每次输出时间戳最小的记录
+    // 只输出本轮开始之前写入的记录 之后写入的留到下一轮 和其它环中同时期的记录一起排序
+    const int64_t drainStart = Timestamp::now().microSecondsSinceEpoch();
+    bool handled = false;
+    while (true)
+    {
+        int earliest = -1;
+        for (size_t i = 0; i < heads.size(); ++i)
+        {
+            // 本轮中途才写入的环也要重新看一下 否则它更早的记录会排在已经输出的记录后面
+            if (!heads[i].valid)
+            {
+                heads[i].valid = rings[i]->front(&heads[i].record);
+            }
+            if (heads[i].valid && recordTime(heads[i].record) <= drainStart
+                && (earliest < 0 || recordTime(heads[i].record) < recordTime(heads[earliest].record)))
+            {
+                earliest = static_cast<int>(i);
+            }
+        }
+        if (earliest < 0)
+        {
+            break;
+        }
+        const std::vector<char> &record = heads[earliest].record;
+        Logger::instance().output(&record[kRecordHeaderSize],
+                                  static_cast<int>(record.size() - kRecordHeaderSize));
+        rings[earliest]->pop();
+        heads[earliest].valid = rings[earliest]->front(&heads[earliest].record);
+        handled = true;
+    }
+
+    // 释放线程已经退出并且已经取空的日志环
+    {
+        std::unique_lock<std::mutex> lock(ringsMutex_);
+        for (std::vector<LogRing*>::iterator it = rings_.begin(); it != rings_.end(); )
+        {
+            if ((*it)->closed() && (*it)->empty())
+            {
+                delete *it;
+                it = rings_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    return handled;
+}
+
+void RingLogging::reportDropped()
+{
+    for (int level = 0; level < kNumLevels; ++level)
+    {
+        uint64_t dropped = dropped_[level].load(std::memory_order_relaxed);
+        if (dropped != reported_[level])
+        {
+            char msg[128];
+            int len = snprintf(msg, sizeof msg, "RingLogging dropped %llu log lines of level %d (total %llu)",
+                               static_cast<unsigned long long>(dropped - reported_[level]), level,
+                               static_cast<unsigned long long>(dropped));
+            char line[256];
+            int lineLen = Logger::formatLine(line, sizeof line, ERROR, Timestamp::now(), msg,
+                                             Logger::truncatedLength(len, sizeof msg));
+            Logger::instance().output(line, lineLen);
+            reported_[level] = dropped;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+class LogRing;
+class Thread;
+
+/*
+ * 每线程无锁日志环
+ * - 每个写日志的线程(EventLoopThread在启动时预先创建)拥有一个SPSC的LogRing
+ *   Logger::log格式化好一行后只写入自己的环 线程之间写日志互不竞争
+ * - 后端线程取出所有环中的记录 按时间戳归并后交给Logger的输出函数(stdout/AsyncLogging等)
+ *   归并是尽力而为的：输出每条记录前都会重新查看所有的环 但一个线程取了时间之后
+ *   过了一段时间才写入环的话 它的记录可能排在已经输出的、时间稍晚的记录之后
+ * - 环满时的处理策略可以按级别配置：
+ *   kBlock     等待后端腾出空间 不丢日志
+ *   kDiscard   直接丢弃
+ *   kCountDrop 丢弃并计数 后端定期输出一条丢弃统计 计数可以通过droppedCount查询
+ * FATAL日志不经过环 直接输出并刷新 进程随后退出
+ */
+class RingLogging : noncopyable
+{
+public:
+    enum OverflowPolicy
+    {
+        kBlock,
+        kDiscard,
+        kCountDrop,
+    };
+
+    static RingLogging& instance();
+
+    // 是否开启了每线程日志环 Logger::log据此选择路径
+    static bool enabled() { return s_enabled_.load(std::memory_order_relaxed); }
+
+    // 以下设置需要在start之前调用
+    void setRingSize(size_t bytes) { ringSize_ = bytes; }
+    void setOverflowPolicy(int level, OverflowPolicy policy);
+
+    void start();
+    // 停止后端线程 取完所有剩余的记录
+    void stop();
+
+    // 为当前线程预先创建日志环 EventLoopThread启动时调用
+    void attachThread();
+
+    // 写入一行已经格式化好的日志
+    void append(int level, Timestamp time, const char *line, int len);
+
+    // 某个级别因为环满被丢弃的日志条数(kCountDrop策略)
+    uint64_t droppedCount(int level) const;
+    uint64_t droppedCount() const;
+
+private:
+    static const int kNumLevels = 4;
+
+    RingLogging();
+    ~RingLogging();
+
+    LogRing* threadRing();
+    void threadFunc();
+    // 归并输出所有环中的记录 返回是否输出了记录
+    bool drain();
+    // 丢弃计数有变化时输出一条统计
+    void reportDropped();
+
+    static std::atomic_bool s_enabled_;
+
+    size_t ringSize_;
+    OverflowPolicy policies_[kNumLevels];
+    std::atomic<uint64_t> dropped_[kNumLevels];
+    uint64_t reported_[kNumLevels]; // 已经报告过的丢弃条数 只由后端线程访问
+
+    std::mutex ringsMutex_;
+    std::vector<LogRing*> rings_;
+
+    std::atomic_bool running_;
+    std::unique_ptr<Thread> thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
@@ -102,6 +102,23 @@ void Socket::setTcpNoDelay(bool on)
     ::setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof optval);
 }
 
+void Socket::setTcpCork(bool on)
+{
+    int optval = on ? 1 : 0;
+    ::setsockopt(sockfd_, IPPROTO_TCP, TCP_CORK, &optval, sizeof optval);
+}
+
+void Socket::setUserTimeout(unsigned int ms)
+{
+    ::setsockopt(sockfd_, IPPROTO_TCP, TCP_USER_TIMEOUT, &ms, sizeof ms);
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) == 0;
+}
+
 // 设置套接字是否允许地址重用
 // on 是一个布尔类型的参数，true 表示允许，false 表示不允许
 void Socket::setReuseAddr(bool on)
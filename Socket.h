@@ -21,6 +21,12 @@ public:
     void shutdownWrite();
 
     void setTcpNoDelay(bool on);
+    // TCP_CORK 开启后不足一个MSS的数据先不发送 关闭时立刻发出
+    void setTcpCork(bool on);
+    // SO_ZEROCOPY 内核不支持时返回false
+    bool setZeroCopy(bool on);
+    // TCP_USER_TIMEOUT 已发出的数据超过ms毫秒没有被确认时内核放弃连接 0表示使用系统默认
+    void setUserTimeout(unsigned int ms);
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
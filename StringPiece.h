@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <ostream>
+
+/*
+ * 不持有内存的字符串视图 (C++11中没有std::string_view)
+ * 只记录指针和长度 拷贝代价和指针一样 调用者负责保证指向的内存有效
+ */
+class StringPiece
+{
+public:
+    StringPiece()
+        : ptr_(nullptr)
+        , length_(0)
+    {
+    }
+    StringPiece(const char *str)
+        : ptr_(str)
+        , length_(str ? ::strlen(str) : 0)
+    {
+    }
+    StringPiece(const std::string &str)
+        : ptr_(str.data())
+        , length_(str.size())
+    {
+    }
+    StringPiece(const char *data, size_t len)
+        : ptr_(data)
+        , length_(len)
+    {
+    }
+
+    const char *data() const { return ptr_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    const char *begin() const { return ptr_; }
+    const char *end() const { return ptr_ + length_; }
+
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    void clear() { ptr_ = nullptr; length_ = 0; }
+    void set(const char *data, size_t len) { ptr_ = data; length_ = len; }
+
+    // 去掉前n个字符
+    void removePrefix(size_t n) { ptr_ += n; length_ -= n; }
+    // 去掉后n个字符
+    void removeSuffix(size_t n) { length_ -= n; }
+
+    StringPiece substr(size_t pos, size_t n = std::string::npos) const
+    {
+        if (pos > length_)
+        {
+            pos = length_;
+        }
+        if (n > length_ - pos)
+        {
+            n = length_ - pos;
+        }
+        return StringPiece(ptr_ + pos, n);
+    }
+
+    bool startsWith(const StringPiece &x) const
+    {
+        return length_ >= x.length_ && ::memcmp(ptr_, x.ptr_, x.length_) == 0;
+    }
+
+    bool operator==(const StringPiece &x) const
+    {
+        return length_ == x.length_ && ::memcmp(ptr_, x.ptr_, length_) == 0;
+    }
+    bool operator!=(const StringPiece &x) const { return !(*this == x); }
+
+    std::string asString() const { return std::string(ptr_, length_); }
+
+private:
+    const char *ptr_;
+    size_t length_;
+};
+
+inline std::ostream& operator<<(std::ostream &os, const StringPiece &piece)
+{
+    return os.write(piece.data(), piece.size());
+}
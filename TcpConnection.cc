@@ -8,12 +8,18 @@
 #include <sys/sendfile.h>
 #include <fcntl.h> // for open
 #include <unistd.h> // for close
+#include <limits.h> // for IOV_MAX
+#include <sys/uio.h> // for writev
+#include <netinet/in.h>
+#include <linux/errqueue.h> // for sock_extended_err
+#include <algorithm>
 
 #include "TcpConnection.h"
 #include "Logger.h"
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "TimingWheel.h"
 
 static EventLoop* CheckLoopNotNull(EventLoop *loop)
 {
@@ -33,11 +39,17 @@ TcpConnection::TcpConnection(EventLoop *loop,
     , name_(nameArg)
     , state_(kConnecting)
     , reading_(true)
-    , socket_(new Socket(sockfd))
+    , socket_(sockfd)
     , channel_(new Channel(loop, sockfd))
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64*1024*1024)  // 64M
+    , shrinkThreshold_(0)
+    , inputBuffer_(loop->bufferPool())
+    , outputBuffer_(loop->bufferPool())
+    , relayEof_(false)
+    , corked_(false)
+    , flushQueued_(false)
 {
     // 下面给channel设置相应的回调函数， poller给channel通知感兴趣的事件发生了，channel会回调相应的回调函数
     channel_->setReadCallback(
@@ -49,11 +61,11 @@ TcpConnection::TcpConnection(EventLoop *loop,
     channel_->setCloseCallback(
         std::bind(&TcpConnection::handleClose, this)
     );
-    channel_->setCloseCallback(
-        std::bind(&TcpConnection::handleError,this)
-    ); 
+    channel_->setErrorCallback(
+        std::bind(&TcpConnection::handleError, this)
+    );
     LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+    socket_.setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
@@ -66,91 +78,700 @@ TcpConnection::~TcpConnection()
  */
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
-    
-    ssize_t nwrote = 0; // 用于记录实际写入的字节数
-    size_t remaining = len; // 记录剩余未发送的字节数，初始值为要发送数据的总长度
-    bool faultError = false; // 标记是否出现错误
+    size_t nwrote = 0; // 用于记录实际写入的字节数
+    if (!writeDirectly(data, len, &nwrote))
+    {
+        return;
+    }
+    size_t remaining = len - nwrote; // 记录剩余未发送的字节数
+    if (remaining > 0)
+    {
+        size_t oldLen = outputBuffer_.readableBytes();
+        // 将剩余未发送的数据添加到输出缓冲区
+        outputBuffer_.append(static_cast<const char*>(data) + nwrote, remaining);
+        outputQueued(oldLen);
+    }
+}
 
-    // 检查连接状态，如果连接已经断开，则记录错误日志并放弃发送数据，直接返回
+// 共享的payload只在输出队列中记录引用 直接写不完的部分不拷贝
+void TcpConnection::sendPayloadInLoop(const PayloadPtr &payload)
+{
+    if (zeroCopyEligible(payload->size()))
+    {
+        // 零拷贝只能由ChainBuffer::writeFd发出 它会保留payload的引用直到内核完成
+        if (state_ == kDisconnected)
+        {
+            LOG_ERROR_RATE_LIMITED(10, 20, "disconnected, give up writing!");
+            return;
+        }
+        size_t oldLen = outputBuffer_.readableBytes();
+        outputBuffer_.append(payload);
+        if (!corked_ && oldLen == 0 && !flushOutput())
+        {
+            return;
+        }
+        if (outputBuffer_.readableBytes() > 0)
+        {
+            outputQueued(oldLen);
+        }
+        return;
+    }
+    size_t nwrote = 0;
+    if (!writeDirectly(payload->data(), payload->size(), &nwrote))
+    {
+        return;
+    }
+    if (nwrote < payload->size())
+    {
+        size_t oldLen = outputBuffer_.readableBytes();
+        outputBuffer_.append(payload, nwrote);
+        outputQueued(oldLen);
+    }
+}
+
+// 多个片段用一次writev写出 写不完的部分按片段排进输出队列
+void TcpConnection::sendvInLoop(const SendSlice *slices, size_t count)
+{
     if (state_ == kDisconnected)
     {
-        LOG_ERROR("disconnected, give up writing!");
+        LOG_ERROR_RATE_LIMITED(10, 20, "disconnected, give up writing!");
+        return;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        total += slices[i].size;
+    }
+    if (total == 0)
+    {
         return;
     }
 
-    // 检查channel_ 是否正在进行写操作，并且输出缓冲区没有待发送数据
-    // 表示channel_第一次开始写数据，且缓冲区为空
-    if (channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    size_t nwrote = 0;
+    // 和writeDirectly一样 只有之前的数据都发完了才能直接写
+    if (!corked_ && !channel_->isWriting() && outputBuffer_.readableBytes() == 0)
     {
-        // 尝试将数据写入channel_对应的文件描述符
-        nwrote = ::write(channel_->fd(), data, len);
-        // 写入成功 即写入的字节数大于等于0
-        if (nwrote >= 0)
+        struct iovec vec[IOV_MAX];
+        int iovcnt = 0;
+        for (size_t i = 0; i < count && iovcnt < IOV_MAX; ++i)
         {
-            // 更新剩余未发送的字节数
-            remaining = len - nwrote;
-            // 若剩余未发送的字节数为0，说明数据全部发送完成
-            // 并且存在写完成回调函数writeCompleteCallback_
-            if (remaining == 0 && writeCompleteCallback_)
+            if (slices[i].size > 0)
+            {
+                vec[iovcnt].iov_base = const_cast<char*>(slices[i].data);
+                vec[iovcnt].iov_len = slices[i].size;
+                ++iovcnt;
+            }
+        }
+        ssize_t n = ::writev(channel_->fd(), vec, iovcnt);
+        if (n >= 0)
+        {
+            nwrote = static_cast<size_t>(n);
+            if (nwrote == total && writeCompleteCallback_)
             {
-                // 既然在这里数据全部发送完成，就不用再给Channel设置epollout事件
-                // 将写完成回调函数加入事件循环的队列中，后续会执行该回调
                 loop_->queueInLoop(
                     std::bind(writeCompleteCallback_, shared_from_this())
                 );
             }
         }
-        else // 写入失败 即写入的字节数小于0
+        else if (errno != EWOULDBLOCK)
         {
-            // 将实际写入字节数置为0
-            nwrote = 0;
-            // 若错误码不是 EWOULDBLOCK (表示当前不能立即写入，需要等待)
-            if (errno != EWOULDBLOCK)
+            LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection::sendvInLoop errno=%d\n", errno);
+            if (errno == EPIPE || errno == ECONNRESET)
             {
-                // 记录错误日志
-                LOG_ERROR("TcpConnection::sendInLoop");
-                // 如果错误码是 EPIPE（表示管道破裂，通常是对方关闭连接后继续写）
-                // 或者 ECONNRESET（表示连接被重置）
-                if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE RESET
-                {
-                    // 标记出现了错误
-                    faultError = true;
-                }
+                return;
             }
         }
     }
-    /**
-     * 说明当前这一次write并没有把数据全部发送出去 剩余的数据需要保存到缓冲区当中
-     * 然后给channel注册EPOLLOUT事件，Poller发现tcp的发送缓冲区有空间后会通知
-     * 相应的sock->channel，调用channel对应注册的writeCallback_回调方法，
-     * channel的writeCallback_实际上就是TcpConnection设置的handleWrite回调，
-     * 把发送缓冲区outputBuffer_的内容全部发送完成
-     **/
-    if (!faultError && remaining > 0)
+    if (nwrote == total)
     {
-        // 目前发送缓冲区剩余的待发送的数据的长度
-        size_t oldLen = outputBuffer_.readableBytes();
-        // 如果添加剩余数据后，缓冲区的总长度超过了高水位标记highWaterMark_
-        // 并且之前的缓冲区的长度小于高水位标记
-        // 同时存在高水位标记回调函数highWaterMarkCallback_
-        if (oldLen + remaining >= highWaterMark_ 
-            && oldLen < highWaterMark_ 
-            && highWaterMarkCallback_)
-        {
-            // 将高水位标记回调函数加入事件循环的队列中，后续会执行该回调
-            // 同时传递当前的 TcpConnection 对象指针和新的缓冲区总长度
+        return;
+    }
+
+    size_t oldLen = outputBuffer_.readableBytes();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const SendSlice &slice = slices[i];
+        size_t skip = std::min(nwrote, slice.size);
+        nwrote -= skip;
+        if (skip == slice.size)
+        {
+            continue;
+        }
+        if (slice.payload)
+        {
+            outputBuffer_.append(slice.payload, skip);
+        }
+        else
+        {
+            outputBuffer_.append(slice.data + skip, slice.size - skip);
+        }
+    }
+    outputQueued(oldLen);
+}
+
+void TcpConnection::sendPayloadsInLoop(const std::vector<PayloadPtr> &payloads)
+{
+    std::vector<SendSlice> slices(payloads.begin(), payloads.end());
+    sendvInLoop(slices.data(), slices.size());
+}
+
+/*
+ * 输出队列为空时先尝试直接写socket 通过nwrote返回写出的字节数
+ * 连接已经断开或者写出错(对端关闭/重置)时返回false 剩余的数据不需要再放进缓冲区
+ */
+bool TcpConnection::writeDirectly(const void *data, size_t len, size_t *nwrote)
+{
+    *nwrote = 0;
+    // 检查连接状态，如果连接已经断开，则记录错误日志并放弃发送数据，直接返回
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR_RATE_LIMITED(10, 20, "disconnected, give up writing!");
+        return false;
+    }
+
+    // 检查channel_ 是否没有在关注写事件，并且输出缓冲区没有待发送数据
+    // 表示之前的数据已经发完 可以直接写socket 否则必须排在缓冲区后面保证顺序
+    // corked模式下数据都先进输出队列 等本轮结束时一起写
+    if (corked_ || channel_->isWriting() || outputBuffer_.readableBytes() > 0)
+    {
+        return true;
+    }
+
+    // 尝试将数据写入channel_对应的文件描述符
+    ssize_t n = ::write(channel_->fd(), data, len);
+    // 写入成功 即写入的字节数大于等于0
+    if (n >= 0)
+    {
+        *nwrote = static_cast<size_t>(n);
+        // 若数据全部发送完成，并且存在写完成回调函数writeCompleteCallback_
+        if (*nwrote == len && writeCompleteCallback_)
+        {
+            // 既然在这里数据全部发送完成，就不用再给Channel设置epollout事件
+            // 将写完成回调函数加入事件循环的队列中，后续会执行该回调
             loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+                std::bind(writeCompleteCallback_, shared_from_this())
+            );
         }
-        // 将剩余未发送的数据添加到输出缓冲区
-        outputBuffer_.append((char *)data + nwrote, remaining);
-        // 如果 channel_ 没有注册写事件
-        if (!channel_->isWriting())
+    }
+    // 写入失败 若错误码不是 EWOULDBLOCK (表示当前不能立即写入，需要等待)
+    else if (errno != EWOULDBLOCK)
+    {
+        // 记录错误日志
+        LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection::sendInLoop errno=%d\n", errno);
+        // 如果错误码是 EPIPE（表示管道破裂，通常是对方关闭连接后继续写）
+        // 或者 ECONNRESET（表示连接被重置）
+        if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE RESET
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 说明当前这一次write并没有把数据全部发送出去 剩余的数据已经保存到缓冲区当中
+ * 然后给channel注册EPOLLOUT事件，Poller发现tcp的发送缓冲区有空间后会通知
+ * 相应的sock->channel，调用channel对应注册的writeCallback_回调方法，
+ * channel的writeCallback_实际上就是TcpConnection设置的handleWrite回调，
+ * 把发送缓冲区outputBuffer_的内容全部发送完成
+ **/
+void TcpConnection::outputQueued(size_t oldLen)
+{
+    size_t newLen = outputBuffer_.readableBytes();
+    // 如果添加剩余数据后，缓冲区的总长度超过了高水位标记highWaterMark_
+    // 并且之前的缓冲区的长度小于高水位标记
+    // 同时存在高水位标记回调函数highWaterMarkCallback_
+    if (newLen >= highWaterMark_
+        && oldLen < highWaterMark_
+        && highWaterMarkCallback_)
+    {
+        // 将高水位标记回调函数加入事件循环的队列中，后续会执行该回调
+        // 同时传递当前的 TcpConnection 对象指针和新的缓冲区总长度
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+    }
+    if (channel_->isWriting())
+    {
+        return;
+    }
+    if (corked_)
+    {
+        // 本轮中后续的send继续追加 只在最后写一次
+        if (!flushQueued_)
+        {
+            flushQueued_ = true;
+            loop_->runAfterIteration(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+        }
+    }
+    else
+    {
+        // 注册 channel_ 的写事件，这样 Poller 才能在 TCP 发送缓冲区有空间时通知 channel_
+        channel_->enableWriting(); // 这里一定要注册channel的写事件 否则poller不会给channel通知epollout
+    }
+}
+
+void TcpConnection::setCorked(bool on)
+{
+    loop_->runInLoop(std::bind(&TcpConnection::setCorkedInLoop, shared_from_this(), on));
+}
+
+void TcpConnection::setCorkedInLoop(bool on)
+{
+    // 关闭时已经积累的数据仍由安排好的flushCorked写出
+    corked_ = on;
+}
+
+void TcpConnection::flushCorked()
+{
+    flushQueued_ = false;
+    flushOutput();
+}
+
+bool TcpConnection::flushOutput()
+{
+    if (state_ == kDisconnected)
+    {
+        return false;
+    }
+    // 已经在关注写事件的话由handleWrite继续发送
+    if (channel_->isWriting() || outputBuffer_.readableBytes() == 0)
+    {
+        return true;
+    }
+    // 有文件段时writeFd要分成writev和sendfile多次系统调用 用TCP_CORK避免中间发出不满的报文
+    bool cork = !fileCallbacks_.empty();
+    if (cork)
+    {
+        socket_.setTcpCork(true);
+    }
+    int savedErrno = 0;
+    ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+    if (cork)
+    {
+        socket_.setTcpCork(false);
+    }
+    if (n > 0)
+    {
+        refreshIdleTimeout();
+    }
+    if (!notifyFilesSent())
+    {
+        LOG_ERROR("TcpConnection::flushOutput [%s] sendfile errno=%d, close connection\n",
+                  name_.c_str(), savedErrno);
+        handleClose();
+        return false;
+    }
+    if (outputBuffer_.readableBytes() == 0)
+    {
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(
+                std::bind(writeCompleteCallback_, shared_from_this())
+            );
+        }
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+        return true;
+    }
+    if (n < 0 && savedErrno != EWOULDBLOCK)
+    {
+        LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection::flushOutput errno=%d\n", savedErrno);
+        if (savedErrno == EPIPE || savedErrno == ECONNRESET)
+        {
+            return false;
+        }
+    }
+    // 剩下的部分等socket可写时由handleWrite发送
+    channel_->enableWriting();
+    return true;
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t bytes)
+{
+    loop_->runInLoop(std::bind(&TcpConnection::setZeroCopyThresholdInLoop, shared_from_this(), bytes));
+}
+
+void TcpConnection::setZeroCopyThresholdInLoop(size_t bytes)
+{
+    if (bytes > 0 && !socket_.setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopyThreshold [%s] SO_ZEROCOPY not supported errno=%d\n",
+                  name_.c_str(), errno);
+        return;
+    }
+    // 关闭后已经发出的零拷贝仍然要等完成通知 socket上的SO_ZEROCOPY保持开启
+    outputBuffer_.setZeroCopyThreshold(bytes);
+}
+
+bool TcpConnection::handleZeroCopyCompletions()
+{
+    bool handled = false;
+    bool copied = false;
+    size_t completed = 0;
+    while (true)
+    {
+        char control[128];
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        // MSG_ERRQUEUE不会阻塞 取完时返回EAGAIN
+        if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;
+        }
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                && !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                continue;
+            }
+            const struct sock_extended_err *ee =
+                reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            // 一条通知覆盖序号[ee_info, ee_data]的所有发送
+            completed += outputBuffer_.completeZeroCopy(ee->ee_info, ee->ee_data);
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                copied = true;
+            }
+            handled = true;
+        }
+    }
+    if (completed > 0 && zeroCopyCallback_)
+    {
+        zeroCopyCallback_(shared_from_this(), completed, copied);
+    }
+    return handled;
+}
+
+// 连接销毁后检查零拷贝完成通知的间隔(秒)
+static const double kZeroCopyLingerInterval = 0.05;
+// 等待完成通知期间对端不确认数据的最长时间(毫秒) 超过后内核终止连接并释放页面
+static const unsigned int kZeroCopyLingerTimeoutMs = 30 * 1000;
+
+void TcpConnection::lingerZeroCopy()
+{
+    handleZeroCopyCompletions();
+    if (outputBuffer_.zeroCopyInFlight() == 0)
+    {
+        LOG_DEBUG("TcpConnection::lingerZeroCopy [%s] all zero-copy sends completed\n", name_.c_str());
+        return; // 定时器持有的引用随之释放 socket在析构时关闭
+    }
+    loop_->runAfter(kZeroCopyLingerInterval,
+                    std::bind(&TcpConnection::lingerZeroCopy, shared_from_this()));
+}
+
+/*
+ * splice中继的状态 由源连接的relayOut_和目标连接的relayIn_共同持有
+ * 管道中已经从源读出、还没有交给目标的字节数由pipeBytes记录
+ */
+struct SpliceRelay : noncopyable
+{
+    // 管道的期望容量 系统限制(pipe-max-size)更小时使用实际的容量
+    static const int kPipeSize = 256 * 1024;
+
+    SpliceRelay()
+        : capacity(0)
+        , pipeBytes(0)
+        , eof(false)
+    {
+        pipeFds[0] = -1;
+        pipeFds[1] = -1;
+    }
+    ~SpliceRelay()
+    {
+        if (pipeFds[0] >= 0)
+        {
+            ::close(pipeFds[0]);
+            ::close(pipeFds[1]);
+        }
+    }
+
+    bool open()
+    {
+        if (::pipe2(pipeFds, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            pipeFds[0] = -1;
+            pipeFds[1] = -1;
+            return false;
+        }
+        ::fcntl(pipeFds[1], F_SETPIPE_SZ, kPipeSize);
+        int size = ::fcntl(pipeFds[1], F_GETPIPE_SZ);
+        capacity = size > 0 ? static_cast<size_t>(size) : 4096;
+        return true;
+    }
+
+    std::weak_ptr<TcpConnection> source;
+    std::weak_ptr<TcpConnection> target;
+    int pipeFds[2];
+    size_t capacity;
+    size_t pipeBytes;
+    bool eof; // 源已经收到FIN
+};
+
+void TcpConnection::relayTo(const TcpConnectionPtr &dst)
+{
+    loop_->runInLoop(std::bind(&TcpConnection::relayToInLoop, shared_from_this(), dst));
+}
+
+void TcpConnection::relayToInLoop(const TcpConnectionPtr &dst)
+{
+    if (!dst || dst.get() == this || dst->getLoop() != loop_)
+    {
+        LOG_ERROR("TcpConnection::relayTo [%s] target must be another connection in the same loop\n",
+                  name_.c_str());
+        return;
+    }
+    if (state_ != kConnected || dst->state_ != kConnected || relayOut_ || dst->relayIn_)
+    {
+        LOG_ERROR("TcpConnection::relayTo [%s] connection closed or already relaying\n", name_.c_str());
+        return;
+    }
+    std::shared_ptr<SpliceRelay> relay = std::make_shared<SpliceRelay>();
+    if (!relay->open())
+    {
+        LOG_ERROR("TcpConnection::relayTo [%s] pipe2 errno=%d\n", name_.c_str(), errno);
+        return;
+    }
+    relay->source = shared_from_this();
+    relay->target = dst;
+    // 之前已经读到用户态的数据排在目标的输出队列中 管道里的数据要等它们发完
+    if (inputBuffer_.readableBytes() > 0)
+    {
+        dst->send(&inputBuffer_);
+    }
+    relayOut_ = relay;
+    dst->relayIn_ = relay;
+    pumpRelay();
+}
+
+void TcpConnection::pumpRelay()
+{
+    std::shared_ptr<SpliceRelay> relay = relayOut_;
+    TcpConnectionPtr dst = relay->target.lock();
+    if (!dst || dst->state_ == kDisconnected)
+    {
+        stopRelay();
+        forceClose();
+        return;
+    }
+    const unsigned int flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        // 管道 -> 目标 目标的输出队列发完之后才能写 保证和dst->send的数据不交错
+        if (relay->pipeBytes > 0 && !dst->channel_->isWriting() && dst->outputBuffer_.readableBytes() == 0)
+        {
+            ssize_t n = ::splice(relay->pipeFds[0], nullptr, dst->channel_->fd(), nullptr,
+                                 relay->pipeBytes, flags);
+            if (n > 0)
+            {
+                relay->pipeBytes -= static_cast<size_t>(n);
+                dst->refreshIdleTimeout();
+                progress = true;
+            }
+            else if (n < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection::pumpRelay [%s] write errno=%d\n",
+                                       dst->name().c_str(), errno);
+                stopRelay();
+                dst->forceClose();
+                forceClose();
+                return;
+            }
+        }
+        // 源 -> 管道
+        if (!relay->eof && relay->pipeBytes < relay->capacity)
+        {
+            ssize_t n = ::splice(channel_->fd(), nullptr, relay->pipeFds[1], nullptr,
+                                 relay->capacity - relay->pipeBytes, flags);
+            if (n > 0)
+            {
+                relay->pipeBytes += static_cast<size_t>(n);
+                refreshIdleTimeout();
+                progress = true;
+            }
+            else if (n == 0)
+            {
+                relay->eof = true;
+            }
+            else if (errno != EAGAIN && errno != EINTR)
+            {
+                LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection::pumpRelay [%s] read errno=%d\n",
+                                       name_.c_str(), errno);
+                stopRelay();
+                dst->shutdown();
+                handleClose();
+                return;
+            }
+        }
+    }
+
+    if (relay->pipeBytes > 0)
+    {
+        // 目标暂时不能接收 停止读源 目标可写时由handleWrite再调用pumpRelay
+        // 管道按页计数 满的时候pipeBytes可能还没到capacity 所以这里不比较容量
+        if (channel_->isReading())
+        {
+            channel_->disableReading();
+        }
+        if (!dst->channel_->isWriting())
+        {
+            dst->channel_->enableWriting();
+        }
+    }
+    else if (relay->eof)
+    {
+        // 源的数据全部转发完了 把半关闭传给目标
+        stopRelay();
+        dst->shutdown();
+        if (relayIn_)
+        {
+            // 反方向还在转发 不再读 由反方向结束时的stopRelay关闭本连接
+            relayEof_ = true;
+            channel_->disableReading();
+        }
+        else
+        {
+            handleClose();
+        }
+    }
+    else if (!channel_->isReading())
+    {
+        channel_->enableReading();
+    }
+}
+
+void TcpConnection::stopRelay()
+{
+    std::shared_ptr<SpliceRelay> relay;
+    relay.swap(relayOut_);
+    if (!relay)
+    {
+        return;
+    }
+    TcpConnectionPtr dst = relay->target.lock();
+    if (dst && dst->relayIn_ == relay)
+    {
+        dst->relayIn_.reset();
+        if (dst->relayEof_)
+        {
+            // 两个方向都结束了 转发的数据已经在内核的发送缓冲区中 关闭时仍会发出
+            dst->forceClose();
+        }
+    }
+}
+
+void TcpConnection::detachRelays()
+{
+    if (relayOut_)
+    {
+        TcpConnectionPtr dst = relayOut_->target.lock();
+        stopRelay();
+        if (dst)
+        {
+            dst->shutdown();
+        }
+    }
+    if (relayIn_)
+    {
+        // 目标已经不在了 源上还没转发的数据没有意义
+        TcpConnectionPtr src = relayIn_->source.lock();
+        relayIn_.reset();
+        if (src)
+        {
+            src->stopRelay();
+            src->forceClose();
+        }
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length, const SendFileCallback &cb)
+{
+    // 不论连接状态都交给loop线程 没有连接时由sendFileInLoop回调失败 调用者据此关闭fd
+    loop_->runInLoop(std::bind(
+        &TcpConnection::sendFileInLoop, shared_from_this(), fd, offset, length, cb));
+}
+
+// 文件段总是先进入输出队列 由随后的EPOLLOUT在handleWrite中调用sendfile发送
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length, const SendFileCallback &cb)
+{
+    if (state_ != kConnected)
+    {
+        // 已经shutdown或者断开 文件段发不出去了
+        if (cb)
+        {
+            loop_->queueInLoop(std::bind(cb, shared_from_this(), false));
+        }
+        return;
+    }
+    if (fd < 0 || offset < 0)
+    {
+        // 不能进入输出队列 也不能占用fileCallbacks_中的位置 否则后面的回调会错位
+        LOG_ERROR("TcpConnection::sendFile [%s] invalid fd=%d offset=%lld\n",
+                  name_.c_str(), fd, static_cast<long long>(offset));
+        if (cb)
+        {
+            loop_->queueInLoop(std::bind(cb, shared_from_this(), false));
+        }
+        return;
+    }
+    if (length == 0)
+    {
+        if (cb)
+        {
+            loop_->queueInLoop(std::bind(cb, shared_from_this(), true));
+        }
+        return;
+    }
+    size_t oldLen = outputBuffer_.readableBytes();
+    outputBuffer_.appendFile(fd, offset, length);
+    fileCallbacks_.push_back(cb);
+    outputQueued(oldLen);
+}
+
+bool TcpConnection::notifyFilesSent()
+{
+    bool failed = false;
+    size_t finished = outputBuffer_.takeFinishedFiles(&failed);
+    if (finished == 0)
+    {
+        return true;
+    }
+    finished = std::min(finished, fileCallbacks_.size());
+    for (size_t i = 0; i < finished; ++i)
+    {
+        if (fileCallbacks_[i])
+        {
+            // 失败的总是这一批中的最后一段
+            bool ok = !(failed && i == finished - 1);
+            loop_->queueInLoop(std::bind(fileCallbacks_[i], shared_from_this(), ok));
+        }
+    }
+    fileCallbacks_.erase(fileCallbacks_.begin(), fileCallbacks_.begin() + finished);
+    return !failed;
+}
+
+void TcpConnection::abortPendingFiles()
+{
+    notifyFilesSent();
+    outputBuffer_.retrieveAll();
+    for (const SendFileCallback &cb : fileCallbacks_)
+    {
+        if (cb)
         {
-            // 注册 channel_ 的写事件，这样 Poller 才能在 TCP 发送缓冲区有空间时通知 channel_
-            channel_->enableWriting(); // 这里一定要注册channel的写事件 否则poller不会给channel通知epollout
+            loop_->queueInLoop(std::bind(cb, shared_from_this(), false));
         }
     }
+    std::vector<SendFileCallback>().swap(fileCallbacks_);
 }
 
 // 关闭半连接的函数，用于发起关闭连接的操作
@@ -175,11 +796,77 @@ void TcpConnection::shutdown()
 void TcpConnection::shutdownInLoop()
 {
     // 检查channel是否没有正在进行写操作
-    if (!channel_->isWriting()) // 说明outputBuffer中的数据已经全部发送完成
+    // 说明outputBuffer中的数据已经全部发送完成 corked模式下可能还有数据在等本轮结束时写出
+    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
     {
         // 如果channel没有正在写，调用socket的shutdownWrite方法关闭写端
         // 这意味着不再向对端发送数据，但仍可接收对端的数据，实现半关闭
-        socket_->shutdownWrite(); // 关闭写端
+        socket_.shutdownWrite(); // 关闭写端
+    }
+}
+
+// 强制关闭连接 例如空闲超时 不管输出缓冲区中是否还有数据未发送
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        // 和对端关闭连接的处理流程相同
+        handleClose();
+    }
+}
+
+// 时间轮中的条目到期 连接空闲超时
+// 使用weak_ptr 时间轮不延长TcpConnection的生命周期
+static void onIdleTimeout(const std::weak_ptr<TcpConnection> &weakConn)
+{
+    TcpConnectionPtr conn = weakConn.lock();
+    if (conn)
+    {
+        LOG_INFO("TcpConnection::onIdleTimeout [%s] idle timeout, force close\n", conn->name().c_str());
+        conn->forceClose();
+    }
+}
+
+void TcpConnection::setIdleTimeout(double seconds)
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds));
+}
+
+void TcpConnection::setIdleTimeoutInLoop(double seconds)
+{
+    cancelIdleTimeout();
+    if (seconds > 0 && state_ != kDisconnected)
+    {
+        std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+        idleEntry_ = loop_->timingWheel()->add(seconds, std::bind(&onIdleTimeout, weakConn));
+    }
+}
+
+void TcpConnection::refreshIdleTimeout()
+{
+    if (idleEntry_)
+    {
+        loop_->timingWheel()->refresh(idleEntry_);
+    }
+}
+
+void TcpConnection::cancelIdleTimeout()
+{
+    if (idleEntry_)
+    {
+        loop_->timingWheel()->remove(idleEntry_);
+        idleEntry_.reset();
     }
 }
 
@@ -208,17 +895,43 @@ void TcpConnection::connectDestroy()
         channel_->disableAll(); // 把channel的所有感兴趣的事件，从poller中del掉
         connectionCallback_(shared_from_this());
     }
+    cancelIdleTimeout();
+    if (!fileCallbacks_.empty())
+    {
+        abortPendingFiles();
+    }
+    if (relayOut_ || relayIn_)
+    {
+        detachRelays();
+    }
     channel_->remove(); //把channel从poller中删除掉
+    if (outputBuffer_.zeroCopyInFlight() > 0)
+    {
+        // 内核还引用着零拷贝发送的payload 提前释放的话内存被复用后的内容会被发出去
+        // 没发出的数据直接丢弃 已经交给内核的payload和socket保留到完成通知全部到达
+        outputBuffer_.retrieveAll();
+        socket_.setUserTimeout(kZeroCopyLingerTimeoutMs);
+        lingerZeroCopy();
+    }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (relayOut_)
+    {
+        // 中继模式 数据直接由splice转发
+        pumpRelay();
+        return;
+    }
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno,
+                                    loop_->readScratch(), EventLoop::kReadScratchSize);
     if (n > 0) // 有数据到达
     {
+        refreshIdleTimeout();
         // 已建立连接的用户有可读事件发生了 调用用户传入的回调操作onMessage shared_from_this就是获取了TcpConnection的智能指针
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        reclaimInputBuffer();
     }
     else if (n == 0) // 客户端断开
     {
@@ -232,40 +945,71 @@ void TcpConnection::handleRead(Timestamp receiveTime)
     }
 }
 
+// 收到过一次很大的消息之后 不能让接收缓冲区在整个连接的生命周期里一直占着那么多内存
+// 接收缓冲区只会在读事件中变化 所以每次读完检查一次就够了 连接空闲之后不需要再扫描
+void TcpConnection::reclaimInputBuffer()
+{
+    if (shrinkThreshold_ > 0
+        && inputBuffer_.capacity() > shrinkThreshold_
+        && inputBuffer_.readableBytes() < inputBuffer_.capacity() / 4)
+    {
+        inputBuffer_.shrink(0);
+    }
+}
+
 void TcpConnection::handleWrite()//处理写事件
 {
     int savedErrno = 0;
     if (channel_->isWriting())
     {
+        // 作为中继的目标时 可能只是为了等管道中的数据而关注写事件 输出队列是空的
+        bool hadOutput = outputBuffer_.readableBytes() > 0;
+        // 一次唤醒尽量多写 writev收集多个块 直到发完或者socket发送缓冲区满
         ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
         if (n > 0)
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0)
+            refreshIdleTimeout();
+        }
+        if (!notifyFilesSent())
+        {
+            // 文件段已经被丢弃 对端收到的字节流不完整 只能关闭连接
+            LOG_ERROR("TcpConnection::handleWrite [%s] sendfile errno=%d, close connection\n",
+                      name_.c_str(), savedErrno);
+            handleClose();
+            return;
+        }
+        if (outputBuffer_.readableBytes() == 0)
+        {
+            channel_->disableWriting();
+            if (hadOutput && writeCompleteCallback_)
             {
-                channel_->disableWriting();
-                if (writeCompleteCallback_)
-                {
-                    // 换线loop_对应的thread线程，执行回调
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this())
-                    );
-                }
-                if (state_ == kDisconnecting)
+                // 换线loop_对应的thread线程，执行回调
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this())
+                );
+            }
+            if (relayIn_)
+            {
+                // 输出队列发完了 继续把中继管道中的数据交给本连接
+                TcpConnectionPtr src = relayIn_->source.lock();
+                if (src)
                 {
-                    shutdownInLoop();
+                    src->pumpRelay();
                 }
-                
+            }
+            if (state_ == kDisconnecting)
+            {
+                shutdownInLoop();
             }
         }
-        else
+        else if (n < 0 && savedErrno != EWOULDBLOCK)
         {
-            LOG_ERROR("TcpConnection::handleWrite");
+            LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection::handleWrite errno=%d\n", savedErrno);
         }
     }
     else
     {
-        LOG_ERROR("TcpConnection fd=%d is down, no more writing", channel_->fd());
+        LOG_ERROR_RATE_LIMITED(10, 20, "TcpConnection fd=%d is down, no more writing", channel_->fd());
     }
 }
 
@@ -281,6 +1025,16 @@ void TcpConnection::handleClose()
     setState(kDisconnected);
     // 禁用 channel 中所有的事件监听，避免后续不必要的事件触发
     channel_->disableAll();
+    // 连接已经关闭 不再需要空闲超时检测
+    cancelIdleTimeout();
+    if (!fileCallbacks_.empty())
+    {
+        abortPendingFiles();
+    }
+    if (relayOut_ || relayIn_)
+    {
+        detachRelays();
+    }
 
     // 使用 std::shared_from_this() 创建一个指向当前对象的共享指针
     // 这样做的目的是为了在回调函数中安全地使用当前的 TcpConnection 对象
@@ -299,6 +1053,10 @@ void TcpConnection::handleClose()
 // 处理 TCP 连接错误的函数
 void TcpConnection::handleError()
 {
+    // 开启零拷贝后 内核的完成通知也通过EPOLLERR报告 它们不是真正的错误
+    bool zeroCopyNotified = (outputBuffer_.zeroCopyThreshold() > 0 || outputBuffer_.zeroCopyInFlight() > 0)
+                            && handleZeroCopyCompletions();
+
     // 用于存储从 getsockopt 函数获取的套接字选项值
     int optval;
     // 存储 optval 变量的长度
@@ -325,31 +1083,160 @@ void TcpConnection::handleError()
         err = optval;
     }
 
+    if (zeroCopyNotified && err == 0)
+    {
+        return;
+    }
     // 记录错误日志
     // name_.c_str() 获取连接的名称并转换为 C 风格字符串
     // err 是获取到的错误码
     LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name_.c_str(), err);
 }
 
-void TcpConnection::send(const std::string &buf)
+void TcpConnection::send(const StringPiece &message)
 {
     if (state_ == kConnected)
     {
         if (loop_->isInLoopThread())
         {
-            sendInLoop(buf.c_str(), buf.size());
+            sendInLoop(message.data(), message.size());
         }
         else
         {
+            // 视图指向的内存由调用者持有 必须拷贝一份带到loop线程
             loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this,
-                buf.c_str(),
-                buf.size()
+                &TcpConnection::sendStringInLoop,
+                shared_from_this(),
+                message.asString()
             ));
         }
     }
 }
 
+void TcpConnection::send(const void *data, size_t len)
+{
+    send(StringPiece(static_cast<const char*>(data), len));
+}
+
+void TcpConnection::send(std::string &&message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendStringInLoop(message);
+        }
+        else
+        {
+            // 字符串被移动进bind对象 再随着functor移动到loop的任务队列
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendStringInLoop,
+                shared_from_this(),
+                std::move(message)
+            ));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // 移动构造只转移底层内存 buf变为空 仍然使用原来的内存池
+            std::shared_ptr<Buffer> moved = std::make_shared<Buffer>(std::move(*buf));
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendBufferInLoop,
+                shared_from_this(),
+                std::move(moved)
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendBufferInLoop(const std::shared_ptr<Buffer> &buf)
+{
+    sendInLoop(buf->peek(), buf->readableBytes());
+}
+
+void TcpConnection::send(const PayloadPtr &payload)
+{
+    if (state_ == kConnected && payload && payload->size() > 0)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendPayloadInLoop(payload);
+        }
+        else
+        {
+            // 只拷贝引用
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendPayloadInLoop,
+                shared_from_this(),
+                payload
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendv(const SendSlice *slices, size_t count)
+{
+    if (state_ == kConnected && count > 0)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendvInLoop(slices, count);
+        }
+        else
+        {
+            // 返回之后调用者的内存可能失效 普通片段必须拷贝 payload片段只拷贝引用
+            std::vector<PayloadPtr> payloads;
+            std::string pending;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (slices[i].payload)
+                {
+                    if (!pending.empty())
+                    {
+                        payloads.push_back(makePayload(std::move(pending)));
+                        pending.clear();
+                    }
+                    payloads.push_back(slices[i].payload);
+                }
+                else
+                {
+                    pending.append(slices[i].data, slices[i].size);
+                }
+            }
+            if (!pending.empty())
+            {
+                payloads.push_back(makePayload(std::move(pending)));
+            }
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendPayloadsInLoop,
+                shared_from_this(),
+                std::move(payloads)
+            ));
+        }
+    }
+}
+
+void TcpConnection::sendStringInLoop(std::string &message)
+{
+    if (zeroCopyEligible(message.size()))
+    {
+        // 内容移动进payload 内核完成之前由输出队列持有
+        sendPayloadInLoop(makePayload(std::move(message)));
+        return;
+    }
+    sendInLoop(message.data(), message.size());
+}
+
 
 
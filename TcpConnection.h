@@ -3,21 +3,37 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <vector>
+#include <sys/types.h>
 
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
+#include "Payload.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
+#include "Socket.h"
 
 class Channel;
 class EventLoop;
-class Socket;
+struct SpliceRelay;
 
 /*
  * TcpServer => Acceptor => 有一个新用户连接 通过accept函数拿到connfd
  * 
  * => TcpConnection 设置回调 => Channel => Poller => Channel的回调操作
+ *
+ * 每个连接的内存预算(x86_64 libstdc++ 没有数据在收发时)：
+ * - TcpConnection对象和shared_ptr控制块 一次分配 约590字节
+ *   其中输入缓冲区64字节 输出队列112字节 不申请任何内存 有数据时才从loop的BufferPool中取 收发完立刻归还
+ *   六个用户回调(std::function)各32字节 普通函数和只绑定this的bind不会额外分配
+ * - Channel 一次分配 176字节
+ * - 连接名 TcpConnection和TcpServer的map中各一份 加上map节点 约150字节
+ * - 设置了空闲超时时 时间轮条目约100字节
+ * 合计1KB以内 再加上内核中socket和epoll的开销(与接收/发送缓冲区的设置有关)
+ * 一百万个空闲连接在用户态大约占用1GB 收发数据时额外的内存都是临时的
  */
 class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
@@ -38,9 +54,77 @@ public:
 
 
     // 发送数据
-    void send(const std::string &buf); 
+    // 在loop线程中调用时直接写socket 写不完的部分才拷贝到输出缓冲区
+    // 在其它线程中调用时先拷贝一份 再交给loop线程发送
+    void send(const StringPiece &message);
+    void send(const void *data, size_t len);
+    // 字符串常量 避免和send(std::string&&)产生歧义
+    void send(const char *message) { send(StringPiece(message)); }
+    // 接管message的内容 在其它线程中调用时字符串被移动到loop线程 不拷贝
+    void send(std::string &&message);
+    // 发送buf中所有可读的数据并清空buf 在onMessage中转发输入缓冲区时不需要先转成string
+    // 在其它线程中调用时buf的内存被整体转移给loop线程 不拷贝
+    void send(Buffer *buf);
+    // 发送共享的不可变数据 只在输出队列中保存引用 广播给大量连接时每个连接不需要各自拷贝
+    void send(const PayloadPtr &payload);
+    /*
+     * 依次发送多个片段 不需要先拼接成一个字符串
+     * 在loop线程中调用且输出队列为空时 用一次writev直接写socket
+     * 写不完的部分排进输出队列 普通片段拷贝 payload片段只记录引用
+     * 在其它线程中调用时 相邻的普通片段合并拷贝成一个payload再交给loop线程
+     */
+    void sendv(const SendSlice *slices, size_t count);
+    void sendv(const std::vector<SendSlice> &slices)
+    { sendv(slices.data(), slices.size()); }
+    /*
+     * 发送文件fd中[offset, offset+length)的内容 排在已经在输出队列中的数据之后
+     * 由handleWrite用sendfile发送 可能跨越多次EPOLLOUT 数据不经过用户态
+     * fd由调用者负责关闭 在回调之前必须保持打开 回调在loop线程中执行
+     * 每次调用都会有一次回调 连接已经shutdown或者断开时回调finished=false
+     */
+    void sendFile(int fd, off_t offset, size_t length, const SendFileCallback &cb = SendFileCallback());
+    /*
+     * corked模式 适合在一次onMessage中多次send的流水线请求
+     * 开启后send不再直接写socket 只放进输出队列 在本轮事件循环的最后统一写一次
+     * 队列中有文件段时 写的过程中临时开启TCP_CORK 让前面的数据和文件内容合并成满的报文
+     */
+    void setCorked(bool on);
+    bool corked() const { return corked_; }
+    /*
+     * 零拷贝发送 适合几MB以上的响应 bytes为0表示关闭
+     * 开启后不小于bytes的payload和移动进来的std::string用MSG_ZEROCOPY发送 内核直接引用这块内存
+     * 内核发完后通过socket的错误队列通知(EPOLLERR) 在handleError中读取并释放对应的payload
+     * 连接销毁时如果还有没收到通知的发送 内核仍然引用着这些页面 可能还会重传
+     * 这时TcpConnection和socket继续保留 由loop定时读取错误队列 通知全部到达后才释放payload并关闭fd
+     * 为了不无限期等待 保留期间设置TCP_USER_TIMEOUT 对端长时间不确认时由内核终止连接
+     * 内核不支持SO_ZEROCOPY时保持普通发送
+     */
+    void setZeroCopyThreshold(size_t bytes);
+    void setZeroCopyCallback(const ZeroCopyCallback &cb)
+    { zeroCopyCallback_ = cb; }
+    /*
+     * 把本连接收到的数据原样转发给dst 用于TCP中继
+     * 数据经过 socket -> 管道 -> socket 由splice在内核中搬运 不进入inputBuffer_也不调用messageCallback
+     * 已经在inputBuffer_中的数据先通过dst->send发出 保证顺序
+     * 流控是联动的：管道中的数据没有全部交给dst之前不再读本连接 dst可写后继续
+     * 本连接收到FIN时把管道排空后对dst调用shutdown 如果还有dst到本连接的反方向中继 等它也结束后再关闭
+     * 任意一端出错或关闭时中继结束 另一端也会关闭
+     * 两个连接必须属于同一个loop 双向中继需要两个方向各调用一次
+     */
+    void relayTo(const TcpConnectionPtr &dst);
     // 关闭半连接
     void shutdown();
+    // 强制关闭连接 不等待输出缓冲区的数据发送完
+    void forceClose();
+
+    // 设置空闲超时 seconds秒内没有读写事件则强制关闭连接 seconds<=0表示取消
+    // 超时由所属loop的时间轮检测 每次handleRead/handleWrite只刷新到期刻度
+    void setIdleTimeout(double seconds);
+
+    // 接收缓冲区的容量超过bytes时 每次处理完读事件都检查一次
+    // 剩余的数据不到容量的1/4就收缩到刚好放下剩余的数据 0表示不收缩
+    // 需要在connectEstablished之前设置
+    void setBufferShrinkThreshold(size_t bytes) { shrinkThreshold_ = bytes; }
     
     void setConnectionCallback(const ConnectionCallback &cb)
     { connectionCallback_ = cb; }
@@ -75,7 +159,51 @@ private:
 
 
     void sendInLoop(const void *data, size_t len);
+    // 可以接管message的内容 用于零拷贝发送
+    void sendStringInLoop(std::string &message);
+    void sendBufferInLoop(const std::shared_ptr<Buffer> &buf);
+    void sendPayloadInLoop(const PayloadPtr &payload);
+    void sendvInLoop(const SendSlice *slices, size_t count);
+    void sendPayloadsInLoop(const std::vector<PayloadPtr> &payloads);
+    // 输出队列为空时直接写socket 返回false表示连接已经不能再写
+    bool writeDirectly(const void *data, size_t len, size_t *nwrote);
+    // 数据放进输出队列之后 检查高水位并关注写事件
+    void outputQueued(size_t oldLen);
+    void sendFileInLoop(int fd, off_t offset, size_t length, const SendFileCallback &cb);
+    // 对已经结束的文件段执行完成回调 返回false表示有文件段发送失败 需要关闭连接
+    bool notifyFilesSent();
+    // 连接断开 清空输出队列 没有发完的文件段回调finished=false
+    void abortPendingFiles();
+    void setCorkedInLoop(bool on);
+    // 本轮事件循环结束时写出corked期间积累的数据
+    void flushCorked();
+    // 没有在关注写事件时立即写一次输出队列 返回false表示连接已经不能再写
+    bool flushOutput();
+    void setZeroCopyThresholdInLoop(size_t bytes);
+    bool zeroCopyEligible(size_t len) const
+    {
+        return outputBuffer_.zeroCopyThreshold() > 0 && len >= outputBuffer_.zeroCopyThreshold();
+    }
+    // 读取错误队列中的零拷贝完成通知 返回是否读到了通知
+    bool handleZeroCopyCompletions();
+    // 连接销毁后等待剩余的零拷贝完成通知 全部到达后释放对自己的引用
+    void lingerZeroCopy();
+    void relayToInLoop(const TcpConnectionPtr &dst);
+    // 作为中继的源 在两个socket之间搬运数据 并根据管道的状态开关本连接的读事件
+    void pumpRelay();
+    // 作为中继的源 结束中继并关闭管道
+    void stopRelay();
+    // 连接关闭时断开作为源和作为目标的中继 另一端随之关闭
+    void detachRelays();
     void shutdownInLoop();
+    void forceCloseInLoop();
+    void setIdleTimeoutInLoop(double seconds);
+    // 有读写事件 刷新空闲超时
+    void refreshIdleTimeout();
+    // 从时间轮中删除空闲超时条目
+    void cancelIdleTimeout();
+    // 一次读事件处理完之后 接收缓冲区过大时收缩
+    void reclaimInputBuffer();
 
     EventLoop *loop_;   // 这里绝对不是baseLoop，因为TCPConnection都是在subloop里面管理的
     const std::string name_;
@@ -83,7 +211,7 @@ private:
     bool reading_;
 
     // 这里和Acceptor类似 Acceptor=> mainLoop TcpConnection=>subLoop2
-    std::unique_ptr<Socket> socket_;
+    Socket socket_; // 只有一个fd 直接作为成员 不再单独分配
     std::unique_ptr<Channel> channel_;
 
     const InetAddress localAddr_;
@@ -96,8 +224,20 @@ private:
     WriteCompleteCallback writeCompleteCallback_; // 消息发送完成以后的回调
     HighWaterMarkCallback highWaterMarkCallback_; // 高水位回调
     CloseCallback closeCallback_; // 关闭连接的回调
+    ZeroCopyCallback zeroCopyCallback_; // 零拷贝发送完成的回调
     size_t highWaterMark_; // 高水位阈值
+    size_t shrinkThreshold_; // 接收缓冲区收缩的阈值
 
     Buffer inputBuffer_;    // 接受数据的缓冲区
-    Buffer outputBuffer_;   // 发送数据的缓冲区
+    ChainBuffer outputBuffer_; // 发送数据的缓冲区 积压时追加不会搬动已有数据
+
+    TimingWheel::EntryPtr idleEntry_; // 空闲超时在时间轮中的条目 未设置时为空
+    // 输出队列中文件段的完成回调 按加入的顺序 没有回调的文件段占一个空的位置
+    std::vector<SendFileCallback> fileCallbacks_;
+    // 本连接作为源/目标的splice中继 两个连接共享同一个对象 没有中继时为空
+    std::shared_ptr<SpliceRelay> relayOut_;
+    std::shared_ptr<SpliceRelay> relayIn_;
+    bool relayEof_; // 作为中继的源已经收到并转发了FIN 等反方向的中继结束后关闭
+    bool corked_;
+    bool flushQueued_; // 已经安排了本轮结束时的flushCorked
 };
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include "TcpServer.h"
 #include "Logger.h"
 #include "TcpConnection.h"
+#include "BufferPool.h"
+
+// 默认收缩超过1MB的接收缓冲区
+static const size_t kDefaultInputShrinkThreshold = 1024 * 1024;
 
 EventLoop* CheckLoopNotNull(EventLoop *loop)
 {
@@ -26,8 +30,11 @@ TcpServer::TcpServer(EventLoop *loop,
               , threadPool_(new EventLoopThreadPool(loop, name_))
               , connectionCallback_()
               , messageCallback_()
-              , nextConnId_(1)
               , started_(0)
+              , nextConnId_(1)
+              , idleTimeout_(0.0)
+              , inputShrinkThreshold_(kDefaultInputShrinkThreshold)
+              , poolMaxCachedBytes_(BufferPool::kDefaultMaxCachedBytes)
 {
     // 有一个新的客户端的连接，会执行TcpServer::newConnection回调
     acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
@@ -59,6 +66,11 @@ void TcpServer::start()
     if (started_++ == 0) // 防止一个TcpServer对象被start多次
     {
         threadPool_->start(threadInitCallback_); // 启动底层的loop线程池
+        // 内存池只能在所属loop线程中访问
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            ioLoop->runInLoop(std::bind(&BufferPool::setMaxCachedBytes, ioLoop->bufferPool().get(), poolMaxCachedBytes_));
+        }
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
     }
 }
@@ -103,12 +115,13 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     InetAddress localAddr(local);
 
     // 根据连接成功的sockfd，创建一个TcpConnection对象， 用于管理新连接
-    TcpConnectionPtr conn (new TcpConnection(
+    // make_shared把对象和引用计数放在一次分配中
+    TcpConnectionPtr conn = std::make_shared<TcpConnection>(
                         ioLoop,     // 负责处理该处理事件的EventLoop 实例
                         connName,   // 是连接的名称
                         sockfd,     // 连接的套接字描述符
                         localAddr,  // 本地地址
-                        peerAddr)); // 客户端地址
+                        peerAddr);  // 客户端地址
     
     // 将新连接对象存储到 connections_ 映射中， 键为连接名称
     connections_[connName] = conn;
@@ -129,6 +142,14 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
     
+    conn->setBufferShrinkThreshold(inputShrinkThreshold_);
+
+    // 设置空闲超时 在ioLoop中执行 先于connectEstablished入队
+    if (idleTimeout_ > 0)
+    {
+        conn->setIdleTimeout(idleTimeout_);
+    }
+
     // 在ioLoop中直接调用connectEstablished方法， 标志连接已建立
     // 该方法会出发连接建立时的回调函数
     ioLoop->runInLoop(
@@ -47,6 +47,18 @@ public:
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);
 
+    // 设置新连接的空闲超时(秒) 超时未读写的连接会被强制关闭 <=0表示不检测
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+
+    // 缓冲区内存回收的水位 需要在start之前设置
+    // inputShrinkThreshold 连接的接收缓冲区超过该容量并且大部分已经读完时收缩 0表示不收缩
+    // poolMaxCachedBytes   每个subloop的BufferPool最多缓存的空闲内存
+    void setBufferReclaimPolicy(size_t inputShrinkThreshold, size_t poolMaxCachedBytes)
+    {
+        inputShrinkThreshold_ = inputShrinkThreshold;
+        poolMaxCachedBytes_ = poolMaxCachedBytes;
+    }
+
     // 开启服务器监听
     void start();
 
@@ -73,5 +85,8 @@ private:
     std::atomic_int started_;
 
     int nextConnId_;
+    double idleTimeout_; // 连接的空闲超时 由每个subloop的时间轮检测
+    size_t inputShrinkThreshold_; // 连接接收缓冲区收缩的阈值
+    size_t poolMaxCachedBytes_;   // 每个loop的缓冲区内存池缓存的上限
     ConnectionMap connections_; // 保存所有的连接
 };
\ No newline at end of file
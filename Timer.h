@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+// 定时器 记录到期时间、回调以及是否重复
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(++s_numCreated_)
+    {
+    }
+
+    // 定时器到期 执行用户回调
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器 以now为基准重新计算下一次到期时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return s_numCreated_; }
+
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_;  // 到期时间
+    const double interval_; // 重复的间隔(秒) <=0 表示一次性定时器
+    const bool repeat_;
+    const int64_t sequence_; // 全局唯一序号 用于区分地址被复用的Timer对象
+
+    static std::atomic<int64_t> s_numCreated_;
+};
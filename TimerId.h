@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+/*
+ * 定时器的标识 由runAt/runAfter/runEvery返回 用于cancel取消定时器
+ * 可以拷贝 不持有Timer的所有权
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr)
+        , sequence_(0)
+    {
+    }
+
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer)
+        , sequence_(seq)
+    {
+    }
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <set>
+#include <vector>
+#include <utility>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+#include "TimerId.h"
+
+class EventLoop;
+class Timer;
+
+/*
+ * 定时器队列 每个EventLoop拥有一个
+ * 底层使用timerfd，把定时器事件和IO事件统一交给Poller监听
+ * timerfd始终设置为队列中最早到期的定时器的时间，到期后timerfdChannel_产生读事件，
+ * 在loop线程中执行所有到期的定时器回调
+ */
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加一个定时器 线程安全 可以在其它线程中调用
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    // 取消一个定时器 线程安全
+    void cancel(TimerId timerId);
+
+private:
+    // 按照到期时间排序 到期时间相同的按照Timer地址区分
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    // 按照Timer地址排序 用于cancel时查找
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读时的回调 执行所有到期的定时器
+    void handleRead();
+    // 取出所有到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重复的定时器重新加入队列 一次性的定时器释放
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+    // 插入定时器 返回最早到期时间是否改变
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;
+
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;       // 是否正在执行到期定时器的回调
+    ActiveTimerSet cancelingTimers_;  // 回调执行期间被取消的定时器 防止重复定时器被再次加入队列
+};
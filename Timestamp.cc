@@ -1,6 +1,10 @@
 #include "Timestamp.h"
 
 #include <time.h>
+
+// 当前线程缓存的时间 只能通过cachedNow/setCachedNow访问
+static __thread int64_t t_cachedMicroSecondsSinceEpoch = 0;
+
 // 默认构造
 Timestamp::Timestamp():microSecondsSinceEpoch_(0) {}
 
@@ -8,23 +12,71 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
             : microSecondsSinceEpoch_(microSecondsSinceEpoch)
             {}
 
+static int64_t clockMicroSeconds(clockid_t clockId)
+{
+    struct timespec ts;
+    ::clock_gettime(clockId, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
 
+// 定时器和延迟统计需要亚秒级的精度 这里取微秒级的时间
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    return Timestamp(clockMicroSeconds(CLOCK_REALTIME));
+}
+
+Timestamp Timestamp::monotonicNow()
+{
+    return Timestamp(clockMicroSeconds(CLOCK_MONOTONIC));
+}
+
+Timestamp Timestamp::cachedNow()
+{
+    if (__builtin_expect(t_cachedMicroSecondsSinceEpoch == 0, 0))
+    {
+        return now();
+    }
+    return Timestamp(t_cachedMicroSecondsSinceEpoch);
+}
+
+void Timestamp::setCachedNow(Timestamp now)
+{
+    t_cachedMicroSecondsSinceEpoch = now.microSecondsSinceEpoch();
 }
 
 std::string Timestamp::toString() const
+{
+    return toFormattedString(false);
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
 {
     char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-        tm_time->tm_year + 1900,  // tm_year成员存储的是从 1900 年开始计算的年数
-        tm_time->tm_mon + 1,      // tm_mon成员存储的是从 0 开始计数的月份
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    tm tm_time;
+    localtime_r(&seconds, &tm_time); // localtime不是线程安全的
+    if (showMicroseconds)
+    {
+        int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+        snprintf(buf, sizeof buf, "%4d/%02d/%02d %02d:%02d:%02d.%06d",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec,
+            microseconds);
+    }
+    else
+    {
+        snprintf(buf, sizeof buf, "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900,  // tm_year成员存储的是从 1900 年开始计算的年数
+            tm_time.tm_mon + 1,      // tm_mon成员存储的是从 0 开始计数的月份
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
+    }
     return buf;
 }
 
@@ -33,4 +85,4 @@ std::string Timestamp::toString() const
 // {
 //     std::cout << Timestamp::now().toString() << std::endl;
 //     return 0;
-// }
\ No newline at end of file
+// }
@@ -2,15 +2,58 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
 
 class Timestamp
 {
 public:
     Timestamp();
     explicit Timestamp(int64_t microSecondsSinceEpoch);  // 防止隐式转换对象
+    // 系统时间(CLOCK_REALTIME) 微秒精度
     static Timestamp now();
+    // 单调时间(CLOCK_MONOTONIC) 不受系统时间调整影响 起点不是Epoch 只能用来计算时间差
+    static Timestamp monotonicNow();
+    // 调用线程所在loop缓存的当前时间 每次poll返回时更新一次 读取不需要系统调用
+    // 缓存是每个线程各自的 只反映调用线程自己的loop 精度为一次事件循环
+    // 非loop线程(从来没有poll过)退化为now()
+    static Timestamp cachedNow();
+    // 更新调用线程缓存的时间 只由Poller在loop线程中调用
+    static void setCachedNow(Timestamp now);
+    // 返回一个无效的时间戳 用于表示"没有时间"
+    static Timestamp invalid() { return Timestamp(); }
     std::string toString() const;
-    
+    // 格式化输出 showMicroseconds为true时带上微秒部分 如 2025/01/01 12:00:00.123456
+    std::string toFormattedString(bool showMicroseconds = true) const;
+
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
 private:
     int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 两个时间戳的差值 单位秒 用于统计请求延迟
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+// 在timestamp的基础上增加seconds秒 定时器计算到期时间时使用
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
@@ -0,0 +1,110 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+#include <math.h>
+#include <iterator>
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds, size_t numBuckets)
+    : loop_(loop)
+    , tickSeconds_(tickSeconds)
+    , currentTick_(0)
+    , buckets_(numBuckets)
+    , size_(0)
+    , ticking_(false)
+{
+}
+
+TimingWheel::~TimingWheel()
+{
+    if (ticking_)
+    {
+        loop_->cancel(tickTimer_);
+    }
+}
+
+TimingWheel::EntryPtr TimingWheel::add(double timeoutSeconds, ExpireCallback cb)
+{
+    EntryPtr entry(new Entry);
+    entry->callback = std::move(cb);
+    // 向上取整再多等一格 保证至少空闲了timeoutSeconds秒才会超时
+    entry->timeoutTicks = static_cast<int64_t>(ceil(timeoutSeconds / tickSeconds_)) + 1;
+    entry->deadline = currentTick_ + entry->timeoutTicks;
+    entry->linked = false;
+    link(entry);
+    ++size_;
+
+    // 有条目时才启动定时器 没有使用空闲超时的loop不会被额外唤醒
+    if (!ticking_)
+    {
+        ticking_ = true;
+        tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTick, this));
+    }
+    return entry;
+}
+
+void TimingWheel::remove(const EntryPtr &entry)
+{
+    if (entry->linked)
+    {
+        buckets_[entry->bucket].erase(entry->pos);
+        entry->linked = false;
+        --size_;
+    }
+}
+
+void TimingWheel::link(const EntryPtr &entry)
+{
+    size_t idx = static_cast<size_t>(entry->deadline % static_cast<int64_t>(buckets_.size()));
+    Bucket &bucket = buckets_[idx];
+    entry->bucket = idx;
+    entry->pos = bucket.insert(bucket.end(), entry);
+    entry->linked = true;
+}
+
+void TimingWheel::onTick()
+{
+    ++currentTick_;
+    size_t idx = static_cast<size_t>(currentTick_ % static_cast<int64_t>(buckets_.size()));
+    Bucket &bucket = buckets_[idx];
+
+    // 先把到期的条目全部摘下来再执行回调 回调中可能会remove同一个槽里的其它条目
+    std::vector<EntryPtr> expired;
+    for (Bucket::iterator it = bucket.begin(); it != bucket.end(); )
+    {
+        EntryPtr entry = *it;
+        if (entry->deadline <= currentTick_)
+        {
+            it = bucket.erase(it);
+            entry->linked = false;
+            --size_;
+            expired.push_back(entry);
+        }
+        else
+        {
+            size_t target = static_cast<size_t>(entry->deadline % static_cast<int64_t>(buckets_.size()));
+            if (target == idx) // 还要再转一圈 留在当前槽
+            {
+                ++it;
+            }
+            else // 被刷新过 挂到新的槽上 splice不会使entry->pos失效
+            {
+                Bucket::iterator next = std::next(it);
+                buckets_[target].splice(buckets_[target].end(), bucket, it);
+                entry->bucket = target;
+                it = next;
+            }
+        }
+    }
+
+    for (const EntryPtr &entry : expired)
+    {
+        entry->callback();
+    }
+
+    // 时间轮空了就停止定时器 避免空转
+    if (size_ == 0 && ticking_)
+    {
+        ticking_ = false;
+        loop_->cancel(tickTimer_);
+    }
+}
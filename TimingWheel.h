@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <list>
+#include <vector>
+
+#include "noncopyable.h"
+#include "TimerId.h"
+
+class EventLoop;
+
+/*
+ * 哈希时间轮 每个EventLoop最多拥有一个 用于大量连接的空闲超时检测
+ * - 时间轮由numBuckets个槽组成，每隔tickSeconds秒前进一格，只使用loop上的一个重复定时器驱动
+ * - 每个条目记录自己的到期刻度deadline，刷新(refresh)只更新deadline，不移动链表节点，代价O(1)
+ * - 指针走到某个槽时，槽内deadline已到的条目超时，未到的条目(被刷新过或者超过一圈)挂到新的槽上
+ * 所有接口只能在loop线程中调用
+ */
+class TimingWheel : noncopyable
+{
+public:
+    using ExpireCallback = std::function<void()>;
+
+    struct Entry;
+    using EntryPtr = std::shared_ptr<Entry>;
+    using Bucket = std::list<EntryPtr>;
+
+    struct Entry
+    {
+        ExpireCallback callback;
+        int64_t timeoutTicks; // 超时时长 以tick为单位
+        int64_t deadline;     // 到期的刻度
+        size_t bucket;        // 所在槽的下标
+        Bucket::iterator pos; // 在槽中的位置 用于O(1)删除
+        bool linked;          // 是否还在时间轮中
+    };
+
+    TimingWheel(EventLoop *loop, double tickSeconds = 1.0, size_t numBuckets = 64);
+    ~TimingWheel();
+
+    // 添加一个条目 timeoutSeconds秒内没有refresh则执行cb
+    EntryPtr add(double timeoutSeconds, ExpireCallback cb);
+
+    // 刷新条目的到期时间 只记录新的deadline
+    void refresh(const EntryPtr &entry)
+    {
+        entry->deadline = currentTick_ + entry->timeoutTicks;
+    }
+
+    // 从时间轮中删除条目 不会执行回调
+    void remove(const EntryPtr &entry);
+
+    size_t size() const { return size_; }
+    double tickSeconds() const { return tickSeconds_; }
+
+private:
+    // 定时器回调 时间轮前进一格
+    void onTick();
+    // 按照deadline把条目挂到对应的槽上
+    void link(const EntryPtr &entry);
+
+    EventLoop *loop_;
+    const double tickSeconds_;
+    int64_t currentTick_;
+    std::vector<Bucket> buckets_;
+    size_t size_; // 时间轮中条目的个数
+
+    bool ticking_; // 驱动时间轮的定时器是否已经启动
+    TimerId tickTimer_;
+};
@@ -0,0 +1,94 @@
+#include <Muduo/Logger.h>
+#include <Muduo/LogStream.h>
+#include <Muduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+// LogStream与snprintf格式化路径的对比测试
+// 输出函数替换为只统计字节数 测量的是格式化+Logger::log的开销
+// 用法：./bench_logstream [次数]
+// 注意：CMakeLists默认不开优化 对比前用 -O2 重新编译libMuduo 否则LogStream的转换函数也是未优化的代码
+namespace
+{
+    size_t g_totalBytes = 0;
+
+    void nullOutput(const char *, int len)
+    {
+        g_totalBytes += len;
+    }
+
+    double elapsedSeconds(Timestamp start)
+    {
+        return static_cast<double>(Timestamp::monotonicNow().microSecondsSinceEpoch()
+                                   - start.microSecondsSinceEpoch()) / Timestamp::kMicroSecondsPerSecond;
+    }
+
+    void report(const char *name, int n, double seconds)
+    {
+        printf("%-24s %10d lines %8.3f s %10.1f ns/line\n", name, n, seconds, seconds * 1e9 / n);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    Logger::instance().setOutput(nullOutput);
+
+    const std::string name("TcpServer-0");
+    int fd = 17;
+    long long bytes = 123456789012LL;
+    const void *conn = &fd;
+
+    // 只比较格式化本身 不经过Logger
+    Timestamp start = Timestamp::monotonicNow();
+    for (int i = 0; i < n; ++i)
+    {
+        char buf[1024];
+        int len = snprintf(buf, sizeof buf, "conn %s fd=%d bytes=%lld i=%d ptr=%p",
+                           name.c_str(), fd, bytes, i, conn);
+        g_totalBytes += len;
+    }
+    report("format: snprintf", n, elapsedSeconds(start));
+
+    start = Timestamp::monotonicNow();
+    LogStream stream;
+    for (int i = 0; i < n; ++i)
+    {
+        stream.resetBuffer();
+        stream << "conn " << name << " fd=" << fd << " bytes=" << bytes << " i=" << i << " ptr=" << conn;
+        g_totalBytes += stream.buffer().length();
+    }
+    report("format: LogStream", n, elapsedSeconds(start));
+
+    // 完整的一条日志 包括Logger拼接时间和级别
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < n; ++i)
+    {
+        LOG_INFO("conn %s fd=%d bytes=%lld i=%d ptr=%p", name.c_str(), fd, bytes, i, conn);
+    }
+    report("snprintf (LOG_INFO)", n, elapsedSeconds(start));
+
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < n; ++i)
+    {
+        LOG_STREAM_INFO << "conn " << name << " fd=" << fd << " bytes=" << bytes
+                        << " i=" << i << " ptr=" << conn;
+    }
+    report("LogStream (LOG_STREAM)", n, elapsedSeconds(start));
+
+    // 被运行期级别过滤的日志 LOG_STREAM_DEBUG在默认的MUDUO_MIN_LOG_LEVEL下编译期就去掉了
+    // 这里提高运行期级别 让编译进来的INFO日志只经过运行期的级别检查
+    Logger::setLogLevel(ERROR);
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < n; ++i)
+    {
+        LOG_STREAM_INFO << "conn " << name << " fd=" << fd << " i=" << i;
+    }
+    report("LogStream (filtered)", n, elapsedSeconds(start));
+    Logger::setLogLevel(INFO);
+
+    fprintf(stderr, "total bytes %zu\n", g_totalBytes);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <Muduo/Buffer.h>
+#include <Muduo/ByteSearch.h>
+#include <Muduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+// Buffer::findCRLF/findChar/findAny与std::search、memchr、std::find_first_of的对比测试
+// 分隔符放在数据的末尾 测量的是扫描整段数据的吞吐
+// 用法：./bench_search [数据长度] [次数]
+// 注意：CMakeLists默认不开优化 对比前用 -O2 重新编译libMuduo
+namespace
+{
+    const char kCRLF[] = "\r\n";
+
+    double elapsedSeconds(Timestamp start)
+    {
+        return static_cast<double>(Timestamp::monotonicNow().microSecondsSinceEpoch()
+                                   - start.microSecondsSinceEpoch()) / Timestamp::kMicroSecondsPerSecond;
+    }
+
+    void report(const char *name, size_t len, int iterations, double seconds, const char *found, const char *expected)
+    {
+        double gbps = static_cast<double>(len) * iterations / seconds / 1e9;
+        printf("%-28s %8.3f s %8.2f GB/s %s\n", name, seconds, gbps, found == expected ? "" : "WRONG RESULT");
+    }
+
+    // memchr找'\r'再检查下一个字节 是不用SIMD时常见的写法
+    const char* memchrCRLF(const char *begin, const char *end)
+    {
+        const char *p = begin;
+        while ((p = static_cast<const char*>(::memchr(p, '\r', end - p))) != nullptr)
+        {
+            if (p + 1 < end && p[1] == '\n')
+            {
+                return p;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 4096;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+    if (len < 4)
+    {
+        len = 4;
+    }
+
+    // 类似HTTP头的数据 中间有单独的'\r'和'\n' 末尾才是"\r\n"
+    std::string data;
+    const char *line = "Accept-Encoding: gzip, deflate;\r q=0.9\n ";
+    while (data.size() < len - 2)
+    {
+        data.append(line);
+    }
+    data.resize(len - 2);
+    data.append(kCRLF);
+
+    Buffer buf;
+    buf.append(data.data(), data.size());
+    const char *begin = buf.peek();
+    const char *end = begin + buf.readableBytes();
+    const char *expectedCRLF = end - 2;
+    const char *expectedChar = end - 1; // 数据中没有'#' 单独放一个在最后
+    std::string withHash(data);
+    withHash[len - 1] = '#';
+    Buffer hashBuf;
+    hashBuf.append(withHash.data(), withHash.size());
+
+    printf("implementation: %s, %zu bytes x %d\n", searchImplName(), len, iterations);
+
+    const char *found = nullptr;
+    Timestamp start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = buf.findCRLF();
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("Buffer::findCRLF", len, iterations, elapsedSeconds(start), found, expectedCRLF);
+
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = std::search(begin, end, kCRLF, kCRLF + 2);
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("std::search CRLF", len, iterations, elapsedSeconds(start), found, expectedCRLF);
+
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = memchrCRLF(begin, end);
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("memchr CRLF", len, iterations, elapsedSeconds(start), found, expectedCRLF);
+
+    begin = hashBuf.peek();
+    end = begin + hashBuf.readableBytes();
+    expectedChar = end - 1;
+
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = hashBuf.findChar('#');
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("Buffer::findChar", len, iterations, elapsedSeconds(start), found, expectedChar);
+
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = static_cast<const char*>(::memchr(begin, '#', end - begin));
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("memchr", len, iterations, elapsedSeconds(start), found, expectedChar);
+
+    const char set[] = "#<>{}";
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = hashBuf.findAny(set);
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("Buffer::findAny(5)", len, iterations, elapsedSeconds(start), found, expectedChar);
+
+    start = Timestamp::monotonicNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        found = std::find_first_of(begin, end, set, set + sizeof set - 1);
+        __asm__ __volatile__("" : : "r"(found) : "memory");
+    }
+    report("std::find_first_of(5)", len, iterations, elapsedSeconds(start), found, expectedChar);
+
+    // 续查：数据分两次到达 第二次从上次查过的位置继续
+    size_t half = len / 2;
+    Buffer partial;
+    partial.append(data.data(), half);
+    const char *miss = partial.findCRLF();
+    size_t resume = partial.readableBytes() - 1;
+    partial.append(data.data() + half, len - half);
+    const char *hit = partial.findCRLF(resume);
+    printf("resume from offset %zu: %s\n", resume,
+           miss == nullptr && hit == partial.peek() + len - 2 ? "ok" : "WRONG RESULT");
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <Muduo/TcpServer.h>
+#include <Muduo/Logger.h>
+#include <Muduo/Payload.h>
+#include <Muduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <vector>
+
+// 普通发送与MSG_ZEROCOPY发送的对比测试
+// 服务端在一个loop线程中反复发送同一个payload 客户端线程只读不处理
+// 对每种消息长度分别用拷贝和零拷贝发送total字节 比较服务端loop线程的CPU时间和吞吐
+// 用法：./bench_zerocopy [端口] [每种长度发送的MB数]
+// 注意：
+// - CMakeLists默认不开优化 对比前用 -O2 重新编译libMuduo
+// - 回环地址上内核会把零拷贝的数据再拷贝一次(通知中copied=1) 只能看到通知和页面固定的额外开销
+//   零拷贝的收益需要在真实网卡上测量 这里的结果用来确定阈值的下限
+namespace
+{
+    struct Config
+    {
+        size_t messageSize;
+        bool zeroCopy;
+    };
+
+    struct Result
+    {
+        double serverCpu;   // 服务端loop线程的CPU时间
+        size_t completions; // 零拷贝完成的发送次数
+        bool copied;        // 内核是否退回了拷贝
+    };
+
+    const int kInFlight = 4; // 输出队列中最多同时排队的消息数
+
+    std::mutex g_mutex;
+    Config g_config;
+    size_t g_totalBytes;
+    Result g_result;
+    int g_port;
+
+    double threadCpuSeconds()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+    }
+
+    double elapsedSeconds(Timestamp start)
+    {
+        return static_cast<double>(Timestamp::monotonicNow().microSecondsSinceEpoch()
+                                   - start.microSecondsSinceEpoch()) / Timestamp::kMicroSecondsPerSecond;
+    }
+
+    // 服务端的状态 只在loop线程中访问
+    PayloadPtr g_payload;
+    size_t g_remaining;
+    double g_cpuStart;
+
+    void sendMore(const TcpConnectionPtr &conn)
+    {
+        for (int i = 0; i < kInFlight && g_remaining > 0; ++i)
+        {
+            conn->send(g_payload);
+            --g_remaining;
+        }
+        if (g_remaining == 0)
+        {
+            conn->shutdown();
+        }
+    }
+
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            Config config;
+            size_t total;
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                config = g_config;
+                total = g_totalBytes;
+            }
+            g_payload = makePayload(std::string(config.messageSize, 'z'));
+            g_remaining = total / config.messageSize;
+            g_result.completions = 0;
+            g_result.copied = false;
+            if (config.zeroCopy)
+            {
+                conn->setZeroCopyThreshold(config.messageSize);
+                conn->setZeroCopyCallback([](const TcpConnectionPtr&, size_t completed, bool copied) {
+                    g_result.completions += completed;
+                    g_result.copied = g_result.copied || copied;
+                });
+            }
+            g_cpuStart = threadCpuSeconds();
+            sendMore(conn);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_result.serverCpu = threadCpuSeconds() - g_cpuStart;
+        }
+    }
+
+    void onWriteComplete(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected() && g_remaining > 0)
+        {
+            sendMore(conn);
+        }
+    }
+
+    // 客户端：连接 读到对端关闭 返回读到的字节数
+    size_t drain()
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        ::memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(g_port));
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        std::vector<char> buf(1024 * 1024);
+        size_t total = 0;
+        ssize_t n;
+        while ((n = ::read(fd, &buf[0], buf.size())) > 0)
+        {
+            total += static_cast<size_t>(n);
+        }
+        ::close(fd);
+        return total;
+    }
+
+    void runClient(EventLoop *loop)
+    {
+        const size_t sizes[] = { 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+        printf("%10s %10s %10s %12s %12s %s\n", "size", "mode", "GB/s", "cpu s/GB", "completions", "copied");
+        for (size_t size : sizes)
+        {
+            for (int zc = 0; zc < 2; ++zc)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(g_mutex);
+                    g_config.messageSize = size;
+                    g_config.zeroCopy = zc != 0;
+                }
+                Timestamp start = Timestamp::monotonicNow();
+                size_t bytes = drain();
+                double seconds = elapsedSeconds(start);
+                // 等服务端处理完断开 记录CPU时间
+                ::usleep(100 * 1000);
+                Result result;
+                {
+                    std::lock_guard<std::mutex> lock(g_mutex);
+                    result = g_result;
+                }
+                double gb = static_cast<double>(bytes) / 1e9;
+                printf("%10zu %10s %10.2f %12.3f %12zu %s\n", size, zc ? "zerocopy" : "copy",
+                       gb / seconds, result.serverCpu / gb, result.completions,
+                       zc ? (result.copied ? "yes" : "no") : "-");
+            }
+        }
+        loop->quit();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    g_port = argc > 1 ? atoi(argv[1]) : 9988;
+    g_totalBytes = static_cast<size_t>(argc > 2 ? atol(argv[2]) : 2048) * 1024 * 1024;
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(static_cast<uint16_t>(g_port)), "bench_zerocopy");
+    server.setConnectionCallback(onConnection);
+    server.setWriteCompleteCallback(onWriteComplete);
+    server.start();
+
+    std::thread client(runClient, &loop);
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <Muduo/BinaryLog.h>
+
+#include <stdio.h>
+
+// 二进制日志解码工具 把BinaryLog::start(path)写出的文件还原为文本日志
+// 用法：./logdecoder binary.log [output.txt]  不指定输出文件时打印到stdout
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s binary.log [output.txt]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = ::fopen(argv[1], "rb");
+    if (in == nullptr)
+    {
+        perror("fopen");
+        return 1;
+    }
+    FILE *out = stdout;
+    if (argc > 2)
+    {
+        out = ::fopen(argv[2], "w");
+        if (out == nullptr)
+        {
+            perror("fopen");
+            ::fclose(in);
+            return 1;
+        }
+    }
+
+    bool ok = BinaryLog::decodeFile(in, out);
+    if (!ok)
+    {
+        fprintf(stderr, "%s: truncated or corrupted binary log\n", argv[1]);
+    }
+
+    ::fclose(in);
+    if (out != stdout)
+    {
+        ::fclose(out);
+    }
+    return ok ? 0 : 1;
+}
@@ -50,8 +50,8 @@ private:
                    Buffer *buf,                  // 缓冲区
                    Timestamp time)               // 时间戳
     {
-        std::string msg = buf->retrieveAllAsString();
-        conn->send(msg);
+        // 直接把输入缓冲区交给send 在loop线程中不经过string 每个字节最多拷贝一次
+        conn->send(buf);
         // conn->shutdown(); // 关闭写端 底层响应EPOLLHUP => 执行closeCallback_
     }
     